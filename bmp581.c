@@ -19,8 +19,8 @@ PIN CONNECTIONS
 - CSB -> floating (since, CSB jumper pulls CSB to VDD 3.3V)
 - since it is connected to VDD, need to disable integrated pull-up:
 - resistor: DRIVE_CONFIG.i2c_csb_pup_en = b0 (done by default, see below)
-- INT -> EXTERNAL GND
-- so need to disable INT_CONFIG.int_en (done by default, see below)
+- INT -> EXTERNAL GND, or a host GPIO (see DATA READY INTERRUPT below)
+- when grounded need to disable INT_CONFIG.int_en (done by default, see below)
 
 DESIRABLE DEFAULT WRITABLE REGISTER FIELD VALUES -  by default, the following writable register fields have values:
 - INT_CONFIG.int_mode = b1 (latched)
@@ -58,8 +58,8 @@ DESIRABLE DEFAULT WRITABLE REGISTER FIELD VALUES -  by default, the following wr
 - ODR_CONFIG.odr = b11100 (1 Hz Output Data Rate on Normal Mode)
 - ODR_CONFIG.deep_dis = b0 (one condition satisfied for deep standby)
 - These values are acceptable
-- the device is deep standby (since all conditions satisfied) however
-    since we are using continuous mode, we dont care...
+- the device is deep standby (since all conditions satisfied) until
+    bmp581_configure sets the requested power mode
 
 UNDESIRABLE DEFAULT REGISTER FIELD VALUES
 - By default, the following registers have values:
@@ -73,18 +73,36 @@ REGISTER FIELDS TO SET
 - OSR_CONFIG.osr_t = userinput
 - OSR_CONFIG.osr_p = userinput
 - OSR_CONFIG.press_en = b1
-- ODR_CONFIG.pwr_mode = 11 (continuous mode)
+- ODR_CONFIG.pwr_mode = userinput (see POWER MODES below)
+- ODR_CONFIG.odr = userinput
+- ODR_CONFIG.deep_dis = b1, unless deep standby is asked for
+
+POWER MODES
+- standby: no measurements, lowest power with the registers kept
+- deep standby: standby with ODR_CONFIG.deep_dis = b0. The device only drops
+    into it while the FIFO is disabled, the IIR filters are bypassed and
+    ODR_CONFIG.odr is 5 Hz or slower, so a faster odr is replaced by 1 Hz
+- normal: one measurement every 1/ODR seconds, standby in between. If the
+    oversampling takes longer than the ODR period the device lowers the
+    oversampling by itself and clears OSR_EFF.odr_is_valid; the effective
+    rates are in OSR_EFF.osr_t_eff/osr_p_eff
+- forced: one measurement, then back to standby by itself. Every
+    bmp581_measure_forced starts another one
+- continuous (nonstop): measurements back to back, ODR ignored, every OSR
+    valid
+- the datasheet asks for standby before switching between the other modes
+    and about 2.5 ms to leave deep standby, so bmp581_set_pwr_mode goes
+    through standby and waits BMP581_TIME_MAX_MS first
 
 REGISTER FIELDS NOT TO READ- we dont need to read
-- OSR_EFF because configuration check is only performed in normal mode,
-    not continuous. furthermore, all configurations OSR, ODR should be
-    valid in continuous mode
 - CHIP_STATUS.hif because we can safely assume we are in either I2C
     only mode or SPI and I2C Available
     other register fields since they are irrelevant (e.g. FIFO_DATA)
 
 REGISTER FIELDS TO READ - relevant fields we should read:
-- ODR_CONFIG.pwr_mode -> to check in continuous mode
+- ODR_CONFIG.pwr_mode -> to check the mode was taken
+- OSR_EFF.odr_is_valid -> in normal mode, to check the OSR fits the ODR.
+    OSR_EFF directly follows ODR_CONFIG, so it comes with the same burst read
 - INT_STATUS.por -> to check if a 'random' power-on-reset (aka power-up-reset)
     has occured
 - PRESS_DATA_XLSB, PRESS_DATA_LSB, PRESS_DATA_MSB -> we are measuring this
@@ -112,28 +130,65 @@ READING INT_STATUS and PRESS_DATA
 - Generally the first approach is better since there are fewer I2C write and
     read operations in total. Consequently there will less error checking and
     fewer start, stop and restart bits.
+
+DATA READY INTERRUPT
+- polling INT_STATUS costs a register write (INT_SOURCE), one read per poll
+    and another write (INT_SOURCE) for every wait, and it blocks the caller
+- if INT is wired to a GPIO, bmp581_enable_drdy_irq sets:
+    - INT_CONFIG.int_mode = b0 (pulsed)
+    - INT_CONFIG.int_pol = b1 (active-high)
+    - INT_CONFIG.int_od = b0 (push-pull, no external pull-up needed)
+    - INT_CONFIG.int_en = b1
+    - INT_CONFIG.pad_int_drv unchanged (b0011)
+    - INT_SOURCE.drdy_data_reg_en = b1, left enabled from then on
+- every new pressure sample then pulses INT, and a rising edge GPIO IRQ
+    records time_us_64() as the sample timestamp. No bus traffic is needed to
+    learn that data is ready
+- a power-on-reset clears INT_CONFIG and INT_SOURCE, so bmp581_init
+    reapplies them whenever the interrupt is in use
+
+FIFO MODE
+- the FIFO holds 32 pressure-only (or temperature-only) frames of 3 bytes,
+    or 16 pressure+temperature frames of 6 bytes (temperature first)
+- FIFO_SEL.fifo_frame_sel picks the frame type, FIFO_CONFIG.fifo_threshold
+    sets when INT_STATUS.fifo_ths (and INT, if enabled via INT_SOURCE)
+    fires, FIFO_CONFIG.fifo_mode = b0 keeps streaming and drops the oldest
+    frame when full
+- both registers are only writable in standby, see bmp581_write_fifo
+- FIFO_COUNT says how many frames are waiting; they are then drained with one
+    burst read of FIFO_DATA, which does not auto-increment, so the whole
+    batch costs two transactions instead of one per sample
+- like the interrupt settings, the FIFO settings are reapplied after a
+    power-on-reset
 */
 #include "bmp581.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
 #include <stdbool.h>
 
-#define BMP581_I2C_SLAVE_ADDR 0x47 // due to ADR jumper
 #define BMP581_TIME_POWERUP_MS 2
 #define BMP581_TIME_MAX_MS 4
 #define BMP581_TIME_SOFT_RESET_MS 2
 #define BMP581_BITS_PER_BYTE 8
 #define BMP581_PRESS_WIDTH BMP581_NUM_PRESS_DATA_REGS *BMP581_BITS_PER_BYTE
 #define BMP581_PRESS_RADIX_BIT_POS 6u
+#define BMP581_TEMP_RADIX_BIT_POS 16u
 #define BMP581_MAX_MEASUREMENT_PERIOD_MS 110
 #define MS_TO_US 1000
 #define REG(X) ((enum bmp581_reg_t)(X))
 
-#define NONSTOP true
-#define STOP false
-
 enum bmp581_reg_t
 {
     bmp581_chip_id = 0x01,
+    bmp581_int_config = 0x14,
     bmp581_int_source = 0x15,
+    bmp581_fifo_config = 0x16,
+    bmp581_fifo_count = 0x17,
+    bmp581_fifo_sel = 0x18,
+    bmp581_temp_data_xlsb = 0x1D,
+    bmp581_temp_data_lsb = 0x1E,
+    bmp581_temp_data_msb = 0x1F,
     bmp581_press_data_xlsb = 0x20,
     bmp581_press_data_lsb = 0x21,
     bmp581_press_data_msb = 0x22,
@@ -143,24 +198,54 @@ enum bmp581_reg_t
     bmp581_reserved_reg4 = 0x26,
     bmp581_int_status = 0x27,
     bmp581_status = 0x28,
+    bmp581_fifo_data = 0x29,
     bmp581_osr_config = 0x36,
     bmp581_odr_config = 0x37,
+    bmp581_osr_eff = 0x38,
     bmp581_cmd = 0x7E,
 };
 
+enum bmp581_int_config_field_t
+{
+    bmp581_int_mode_latched = 0b00000001,
+    bmp581_int_pol_high = 0b00000010,
+    bmp581_int_od = 0b00000100,
+    bmp581_int_en = 0b00001000,
+    bmp581_pad_int_drv = 0b11110000
+};
+
 enum bmp581_int_source_field_t
 {
-    bmp581_drdy_data_reg_en = 0b00000001
+    bmp581_drdy_data_reg_en = 0b00000001,
+    bmp581_fifo_ths_en = 0b00000100
     // other fields ignored since irrelevant...
 };
 
 enum bmp581_int_status_field_t
 {
     bmp581_por = 0b00010000, // power on reset
+    bmp581_fifo_ths = 0b00000100,
     bmp581_drdy_data_reg = 0b00000001
     // other fields ignored since irrelevant...
 };
 
+enum bmp581_fifo_config_field_t
+{
+    bmp581_fifo_threshold = 0b00011111,
+    bmp581_fifo_mode_stop_on_full = 0b00100000
+};
+
+enum bmp581_fifo_count_field_t
+{
+    bmp581_fifo_count_mask = 0b00111111
+};
+
+enum bmp581_fifo_sel_field_t
+{
+    bmp581_fifo_frame_sel = 0b00000011,
+    bmp581_fifo_dec_sel = 0b00011100
+};
+
 enum bmp581_status_field_t
 {
     bmp581_status_nvm_rdy = 0b00000010,
@@ -182,21 +267,15 @@ enum bmp581_odr_config_field_t
     bmp581_deep_dis = 0b10000000
 };
 
-enum bmp581_pwr_mode_t
+enum bmp581_osr_eff_field_t
 {
-    bmp581_standby = 0b00,
-    bmp581_normal = 0b01,
-    bmp581_forced = 0b10,
-    bmp581_nonstop = 0b11, // aka continuous mode
+    bmp581_osr_t_eff = 0b00000111,
+    bmp581_osr_p_eff = 0b00111000,
+    bmp581_odr_is_valid = 0b10000000
 };
 
-enum bmp581_odr_t
-{
-    bmp581_1hz = 0x1C << 2
-    // lot other more other output data rate
-    // however since we are using continuous mode, the value
-    // of odr is ignored
-};
+#define BMP581_ODR_SHIFT 2
+#define BMP581_DEEP_STANDBY_FASTEST_ODR bmp581_odr_5_hz
 
 enum bmp581_cmd_t
 {
@@ -217,80 +296,86 @@ enum bmp581_cmd_t
 #define FLAGGED(REG_VAL, FLAG) EXTRACT(REG_VAL, FLAG)
 
 static int bmp581_burst_write(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     size_t len,
     const uint8_t *buf)
 {
-    return i2c_write_blocking(i2c, BMP581_I2C_SLAVE_ADDR, buf, len + 1, STOP);
+    return i2c_device_write(i2c, buf, len + 1);
 }
 
 static int bmp581_reg_write(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_reg_t reg,
     uint8_t val)
 {
     return bmp581_burst_write(i2c, 1, (uint8_t[]){reg, val});
 }
 
-static int bmp581_set_reg_addr(
-    i2c_inst_t *i2c,
+/*
+sets the register address and reads len bytes after a repeated start, as one
+queued transaction. Returns len, PICO_ERROR_GENERIC on a NACK or
+PICO_ERROR_TIMEOUT
+*/
+static int bmp581_burst_read(
+    const i2c_device_t *i2c,
     enum bmp581_reg_t reg,
-    bool nonstop)
+    size_t len,
+    uint8_t o_buf[len])
 {
-    return i2c_write_blocking(i2c, BMP581_I2C_SLAVE_ADDR, (uint8_t[]){reg}, 1,
-                              nonstop);
+    return i2c_device_write_read(i2c, (uint8_t[]){reg}, 1, o_buf, len, NULL);
 }
 
-static int bmp581_burst_read(i2c_inst_t *i2c, size_t len, uint8_t o_buf[len])
-{
-    return i2c_read_blocking(i2c, BMP581_I2C_SLAVE_ADDR, o_buf, len, STOP);
-}
+// when the last pressure read completed, see bmp581_read_time_us
+static uint64_t bmp581_read_us;
 
-static int bmp581_reg_read(i2c_inst_t *i2c, uint8_t *o_reg_val)
+// bmp581_burst_read, also recording when the data arrived in bmp581_read_us
+static int bmp581_burst_read_timed(
+    const i2c_device_t *i2c,
+    enum bmp581_reg_t reg,
+    size_t len,
+    uint8_t o_buf[len])
 {
-    return bmp581_burst_read(i2c, 1, o_reg_val);
+    return i2c_device_write_read(i2c, (uint8_t[]){reg}, 1, o_buf, len,
+                                 &bmp581_read_us);
 }
 
+/*
+the register address write and the data read are one transaction, so a NACK
+cannot be told apart by phase: it is reported as reg_set_nack, a transaction
+the engine gave up on as bmp581_err_i2c_timeout and a short read as
+read_mismatch
+*/
 static enum bmp581_err_t bmp581_burst_read_ex(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_reg_t reg,
     size_t len,
     uint8_t o_buf[len],
     enum bmp581_err_t reg_set_nack,
-    enum bmp581_err_t reg_set_mismatch,
-    enum bmp581_err_t read_nack,
     enum bmp581_err_t read_mismatch)
 {
     int bytes_moved;
-    bytes_moved = bmp581_set_reg_addr(i2c, reg, NONSTOP);
+    bytes_moved = bmp581_burst_read(i2c, reg, len, o_buf);
     if (bytes_moved == PICO_ERROR_GENERIC)
         return reg_set_nack;
-    if (bytes_moved != 1)
-        return reg_set_mismatch;
-    bytes_moved = bmp581_burst_read(i2c, len, o_buf);
-    if (bytes_moved == PICO_ERROR_GENERIC)
-        return read_mismatch;
-    if (bytes_moved != len)
+    if (bytes_moved == PICO_ERROR_TIMEOUT)
+        return bmp581_err_i2c_timeout;
+    if (bytes_moved != (int)len)
         return read_mismatch;
     return bmp581_err_ok;
 }
 
 static enum bmp581_err_t bmp581_reg_read_ex(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_reg_t reg,
     uint8_t *o_reg_val,
     enum bmp581_err_t reg_set_nack,
-    enum bmp581_err_t reg_set_mismatch,
-    enum bmp581_err_t read_nack,
     enum bmp581_err_t read_mismatch)
 {
-    return bmp581_burst_read_ex(
-        i2c, reg, 1, o_reg_val,
-        reg_set_nack, reg_set_mismatch, read_nack, read_mismatch);
+    return bmp581_burst_read_ex(i2c, reg, 1, o_reg_val, reg_set_nack, read_mismatch);
 }
 
 static int bmp581_burst_write_ex(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     size_t len,
     const uint8_t *buf,
     enum bmp581_err_t write_nack,
@@ -306,7 +391,7 @@ static int bmp581_burst_write_ex(
 }
 
 static int bmp581_reg_write_ex(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_reg_t reg,
     uint8_t val,
     enum bmp581_err_t write_nack,
@@ -321,6 +406,11 @@ static int bmp581_reg_write_ex(
     return bmp581_err_ok;
 }
 
+static long bmp581_sign_extend_24(long v)
+{
+    return v & 0x800000l ? v - 0x1000000l : v;
+}
+
 static void bmp581_wait_for_powerup(void) { sleep_ms(BMP581_TIME_POWERUP_MS); }
 
 static void bmp581_wait_max(void) { sleep_ms(BMP581_TIME_MAX_MS); }
@@ -338,8 +428,9 @@ PURPOSE
 - this function performs some checks upon power-up of the bmp581,
     as recommended by the datasheet
 */
-static enum bmp581_err_t bmp581_check_powerup(i2c_inst_t *i2c)
+static enum bmp581_err_t bmp581_check_powerup(const i2c_device_t *i2c)
 {
+    I2C_SITE(__func__);
     // compiler should optimize some of these local variables away
     enum
     {
@@ -359,8 +450,6 @@ static enum bmp581_err_t bmp581_check_powerup(i2c_inst_t *i2c)
     // read out chip_id and check that not zero
     err = bmp581_reg_read_ex(i2c, bmp581_chip_id, &chip_id,
                              bmp581_err_chip_id_set_addr_nack,
-                             bmp581_err_chip_id_set_mismatch,
-                             bmp581_err_chip_id_read_addr_nack,
                              bmp581_err_chip_id_read_mismatch);
     if (err != bmp581_err_ok)
         return err;
@@ -370,8 +459,6 @@ static enum bmp581_err_t bmp581_check_powerup(i2c_inst_t *i2c)
     // and status_nvm_err == 0
     err = bmp581_burst_read_ex(i2c, start_status, num_statuses, statuses,
                                bmp581_err_statuses_set_addr_nack,
-                               bmp581_err_statuses_set_mismatch,
-                               bmp581_err_statuses_read_addr_nack,
                                bmp581_err_statuses_read_mismatch);
     if (err != bmp581_err_ok)
         return err;
@@ -396,45 +483,89 @@ static enum bmp581_err_t bmp581_check_powerup(i2c_inst_t *i2c)
     return bmp581_err_ok;
 }
 
+// ODR_CONFIG.odr in millihertz, indexed by enum bmp581_odr_t
+static const uint32_t bmp581_odr_mhz[] = {
+    240000, 218500, 199100, 179200, 160000, 149300, 140000, 129800,
+    120000, 110100, 100200, 89600, 80000, 70000, 60000, 50000,
+    45000, 40000, 35000, 30000, 25000, 20000, 15000, 10000,
+    5000, 4000, 3000, 2000, 1000, 500, 250, 125};
+static_assert(sizeof bmp581_odr_mhz / sizeof *bmp581_odr_mhz ==
+              bmp581_odr_0_125_hz + 1);
+
+// power mode and ODR of the most recent successful bmp581_configure, used
+// again after a power-on-reset and to size the data ready timeout
+static enum bmp581_pwr_mode_t bmp581_pwr_mode_val = bmp581_nonstop;
+static enum bmp581_odr_t bmp581_odr_val = bmp581_odr_1_hz;
+// FIFO_SEL.fifo_frame_sel to restore after a power-on-reset (see FIFO MODE)
+static uint8_t bmp581_fifo_sel_val;
+
+static uint8_t bmp581_odr_config_val(
+    enum bmp581_pwr_mode_t pwr_mode,
+    enum bmp581_odr_t odr)
+{
+    if (pwr_mode == bmp581_deep_standby)
+        return bmp581_standby | odr << BMP581_ODR_SHIFT;
+    return EXTRACT(pwr_mode, bmp581_pwr_mode) | odr << BMP581_ODR_SHIFT |
+           bmp581_deep_dis;
+}
+
 /*
 PRE:
     - bmp581_check_powerup was called
     - the most recent call to bmp581_check_powerup was successful
+    - the device is in standby or deep standby
 PURPOSE:
 - this function sets:
 - OSR_CONFIG.osr_t = userinput
 - OSR_CONFIG.osr_p = userinput
 - OSR_CONFIG.press_en = b1 (pressure measurements enabled)
 - OSR_CONFIG.reserved_7 = b0 (same as before)
-- ODR_CONFIG.pwr_mode = b11 (continuous mode)
-- ODR_CONFIG.odr = 0x1C (1 Hz output data rate)
-    the value of ODR_CONFIG.odr can be anything since it is
-    ignored in continuous mode. odr is set to the same
-    value it was before
-- ODR_CONFIG.deep_dis = b0
-    i.e. deep_dis is set to the same value it was before
+- ODR_CONFIG.pwr_mode = userinput (see POWER MODES)
+- ODR_CONFIG.odr = userinput, ignored in continuous and forced mode
+- ODR_CONFIG.deep_dis = b0 for deep standby, b1 otherwise
+- in normal mode it then checks OSR_EFF.odr_is_valid and returns
+    bmp581_err_odr_too_fast_for_osr if the device had to lower the
+    oversampling. The device keeps measuring with the effective rates, see
+    bmp581_read_osr_eff
 */
 static enum bmp581_err_t bmp581_configure(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_osr_t_t osr_t,
-    enum bmp581_osr_p_t osr_p)
+    enum bmp581_osr_p_t osr_p,
+    enum bmp581_pwr_mode_t pwr_mode,
+    enum bmp581_odr_t odr)
 {
+    I2C_SITE(__func__);
     enum
     {
         start_config = bmp581_osr_config,
         end_config = bmp581_odr_config,
-        num_configs = end_config - start_config + 1
+        num_configs = end_config - start_config + 1,
+        // OSR_EFF is read back with the configs
+        num_configs_read = bmp581_osr_eff - start_config + 1
     };
     static_assert(start_config + num_configs == end_config + 1);
+    static_assert(bmp581_odr_config + 1 == bmp581_osr_eff);
     uint8_t osr_config;
     uint8_t odr_config;
     uint8_t osr_config_read;
     uint8_t odr_config_read;
-    uint8_t configs[num_configs];
+    uint8_t odr_config_mask = 0xFF;
+    uint8_t configs[num_configs_read];
     enum bmp581_err_t err;
+    if (pwr_mode == bmp581_deep_standby)
+    {
+        if (bmp581_fifo_sel_val)
+            return bmp581_err_deep_standby_fifo_enabled;
+        if (odr < BMP581_DEEP_STANDBY_FASTEST_ODR)
+            odr = bmp581_odr_1_hz;
+    }
+    // forced mode returns to standby by itself after its one measurement
+    if (pwr_mode == bmp581_forced)
+        odr_config_mask = ~bmp581_pwr_mode;
     // write desired osr_config and odr_config to bmp581
     osr_config = osr_t | osr_p | bmp581_press_en;
-    odr_config = bmp581_nonstop | bmp581_1hz;
+    odr_config = bmp581_odr_config_val(pwr_mode, odr);
     err = BMP581_BURST_WRITE_EX(i2c, num_configs, REG(bmp581_osr_config),
                                 bmp581_err_configs_write_addr_nack, bmp581_err_configs_write_mismatch,
                                 osr_config, odr_config);
@@ -446,10 +577,8 @@ static enum bmp581_err_t bmp581_configure(
     characteristics: BMP581_TIME_MAX_MS*/
     bmp581_wait_max();
     // Check To See If Registers Were Set As Intended
-    err = bmp581_burst_read_ex(i2c, start_config, num_configs, configs,
+    err = bmp581_burst_read_ex(i2c, start_config, num_configs_read, configs,
                                bmp581_err_osr_config_set_addr_nack,
-                               bmp581_err_osr_config_set_mismatch,
-                               bmp581_err_configs_read_addr_nack,
                                bmp581_err_configs_read_mismatch);
     if (err != bmp581_err_ok)
         return err;
@@ -457,19 +586,40 @@ static enum bmp581_err_t bmp581_configure(
     odr_config_read = configs[bmp581_odr_config - start_config];
     if (osr_config_read != osr_config)
     {
-        if (osr_config_read != odr_config)
+        if (EXTRACT(odr_config_read, odr_config_mask) !=
+            EXTRACT(odr_config, odr_config_mask))
             return bmp581_err_opposing_configs_read;
         return bmp581_err_opposing_osr_config_read;
     }
-    else if (odr_config_read != odr_config)
+    else if (EXTRACT(odr_config_read, odr_config_mask) !=
+             EXTRACT(odr_config, odr_config_mask))
         return bmp581_err_opposing_odr_config_read;
+    bmp581_pwr_mode_val = pwr_mode;
+    bmp581_odr_val = odr;
+    if (pwr_mode == bmp581_normal &&
+        !FLAGGED(configs[bmp581_osr_eff - start_config], bmp581_odr_is_valid))
+        return bmp581_err_odr_too_fast_for_osr;
     return bmp581_err_ok;
 }
 
+/*
+longest wait for the next sample: one ODR period in normal mode plus the
+measurement itself
+*/
+static uint32_t bmp581_drdy_timeout_ms(void)
+{
+    if (bmp581_pwr_mode_val != bmp581_normal)
+        return BMP581_MAX_MEASUREMENT_PERIOD_MS;
+    return (1000000u + bmp581_odr_mhz[bmp581_odr_val] - 1) /
+               bmp581_odr_mhz[bmp581_odr_val] +
+           BMP581_MAX_MEASUREMENT_PERIOD_MS;
+}
+
 static enum bmp581_err_t bmp581_write_int_source(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     uint8_t int_source_val)
 {
+    I2C_SITE(__func__);
     int bytes_moved;
     enum bmp581_err_t err;
     uint8_t int_source_read = 100;
@@ -480,8 +630,6 @@ static enum bmp581_err_t bmp581_write_int_source(
         return err;
     err = bmp581_reg_read_ex(i2c, bmp581_int_source, &int_source_read,
                              bmp581_err_int_source_set_addr_nack,
-                             bmp581_err_int_source_set_mismatch,
-                             bmp581_err_int_source_read_addr_nack,
                              bmp581_err_int_source_read_mismatch);
     if (err != bmp581_err_ok)
         return err;
@@ -490,9 +638,140 @@ static enum bmp581_err_t bmp581_write_int_source(
     return bmp581_err_ok;
 }
 
-static bmp581_eerr_t bmp581_wait_for_drdy(i2c_inst_t *i2c)
+static enum bmp581_err_t bmp581_reg_write_check(
+    const i2c_device_t *i2c,
+    enum bmp581_reg_t reg,
+    uint8_t val)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    uint8_t val_read;
+    err = bmp581_reg_write_ex(i2c, reg, val,
+                              bmp581_err_fifo_write_addr_nack,
+                              bmp581_err_fifo_write_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    err = bmp581_reg_read_ex(i2c, reg, &val_read,
+                             bmp581_err_fifo_set_addr_nack,
+                             bmp581_err_fifo_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    if (val_read != val)
+        return bmp581_err_opposing_fifo_read;
+    return bmp581_err_ok;
+}
+
+/*
+PURPOSE:
+- writes FIFO_SEL and FIFO_CONFIG. Both may only change in standby mode, so
+    ODR_CONFIG is put into standby around the writes and restored afterwards.
+    Changing FIFO_SEL also flushes the FIFO
+*/
+static enum bmp581_err_t bmp581_write_fifo(
+    const i2c_device_t *i2c,
+    uint8_t fifo_sel,
+    uint8_t fifo_config)
+{
+    enum bmp581_err_t err;
+    uint8_t odr_config;
+    err = bmp581_reg_read_ex(i2c, bmp581_odr_config, &odr_config,
+                             bmp581_err_fifo_set_addr_nack,
+                             bmp581_err_fifo_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    err = bmp581_reg_write_check(i2c, bmp581_odr_config,
+                                 odr_config & ~bmp581_pwr_mode);
+    if (err != bmp581_err_ok)
+        return err;
+    bmp581_wait_max();
+    err = bmp581_reg_write_check(i2c, bmp581_fifo_config, fifo_config);
+    if (err != bmp581_err_ok)
+        return err;
+    err = bmp581_reg_write_check(i2c, bmp581_fifo_sel, fifo_sel);
+    if (err != bmp581_err_ok)
+        return err;
+    return bmp581_reg_write_check(i2c, bmp581_odr_config, odr_config);
+}
+
+// GPIO the INT pin is wired to, or -1 while data ready is polled
+static int bmp581_drdy_gpio = -1;
+// FIFO_CONFIG to restore after a power-on-reset, with bmp581_fifo_sel_val
+static uint8_t bmp581_fifo_config_val;
+
+// with a FIFO threshold set, INT pulses once per batch instead of per sample
+static uint8_t bmp581_int_source_sel(void)
+{
+    if (EXTRACT(bmp581_fifo_sel_val, bmp581_fifo_frame_sel) &&
+        EXTRACT(bmp581_fifo_config_val, bmp581_fifo_threshold))
+        return bmp581_fifo_ths_en;
+    return bmp581_drdy_data_reg_en;
+}
+static volatile bool bmp581_drdy_flag;
+static volatile uint64_t bmp581_drdy_time_us;
+
+static void bmp581_drdy_isr(void)
+{
+    if (bmp581_drdy_gpio < 0 ||
+        !(gpio_get_irq_event_mask(bmp581_drdy_gpio) & GPIO_IRQ_EDGE_RISE))
+        return;
+    gpio_acknowledge_irq(bmp581_drdy_gpio, GPIO_IRQ_EDGE_RISE);
+    bmp581_drdy_time_us = time_us_64();
+    bmp581_drdy_flag = true;
+}
+
+/*
+PURPOSE:
+- sets INT_CONFIG for a push-pull, active-high pulse on INT and enables the
+    data ready interrupt source (see DATA READY INTERRUPT)
+*/
+static enum bmp581_err_t bmp581_configure_int(const i2c_device_t *i2c)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    uint8_t int_config;
+    uint8_t int_config_read;
+    err = bmp581_reg_read_ex(i2c, bmp581_int_config, &int_config,
+                             bmp581_err_int_config_set_addr_nack,
+                             bmp581_err_int_config_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    int_config = EXTRACT(int_config, bmp581_pad_int_drv) |
+                 bmp581_int_pol_high | bmp581_int_en;
+    err = bmp581_reg_write_ex(i2c, bmp581_int_config, int_config,
+                              bmp581_err_int_config_write_addr_nack,
+                              bmp581_err_int_config_write_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    err = bmp581_reg_read_ex(i2c, bmp581_int_config, &int_config_read,
+                             bmp581_err_int_config_set_addr_nack,
+                             bmp581_err_int_config_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    if (int_config_read != int_config)
+        return bmp581_err_opposing_int_config_read;
+    return bmp581_write_int_source(i2c, bmp581_int_source_sel());
+}
+
+/*
+PRE:
+- bmp581_drdy_flag was cleared before the write that starts the measurement;
+    clearing it here could lose an edge that came in the meantime
+*/
+static bmp581_eerr_t bmp581_wait_for_drdy_irq(void)
+{
+    absolute_time_t deadline = make_timeout_time_ms(bmp581_drdy_timeout_ms());
+    while (!bmp581_drdy_flag)
+        if (time_reached(deadline))
+            return bmp581_err_drdy_timeout;
+    return bmp581_err_ok;
+}
+
+static bmp581_eerr_t bmp581_wait_for_drdy(const i2c_device_t *i2c)
 {
+    I2C_SITE(__func__);
     enum bmp581_err_t err;
+    if (bmp581_drdy_gpio >= 0)
+        return bmp581_wait_for_drdy_irq();
     err = bmp581_write_int_source(i2c, bmp581_drdy_data_reg_en);
     if (err != bmp581_err_ok)
         return err;
@@ -502,21 +781,20 @@ static bmp581_eerr_t bmp581_wait_for_drdy(i2c_inst_t *i2c)
         uint8_t int_status;
         err = bmp581_reg_read_ex(i2c, bmp581_int_status, &int_status,
                                  bmp581_err_int_status_set_addr_nack,
-                                 bmp581_err_int_status_set_mismatch,
-                                 bmp581_err_int_status_read_addr_nack,
                                  bmp581_err_int_status_read_mismatch);
         if (err != bmp581_err_ok)
             return err;
         if (FLAGGED(int_status, bmp581_drdy_data_reg))
             break;
         if (absolute_time_diff_us(start, get_absolute_time()) / MS_TO_US >
-            BMP581_MAX_MEASUREMENT_PERIOD_MS)
+            bmp581_drdy_timeout_ms())
             return bmp581_err_drdy_timeout;
         sleep_us(500); // no need to overwork rpi pico
     }
     err = bmp581_write_int_source(i2c, 0);
     if (err != bmp581_err_ok)
         return -err;
+    return bmp581_err_ok;
 }
 
 /*
@@ -528,25 +806,202 @@ PURPOSE
 - if there is an error, it returns the error
 - otherwise, it calls bmp581_configure to configure the
     bmp581,
-- if there is an error, it returns the error code
-- otherwise, it calls bmp581_wait_for_drdy to cause the
-    rpi pico to wait until bmp581_wait_for_drdy is ready
+- if there is an error, it returns the error code.
+    bmp581_err_odr_too_fast_for_osr is only a warning: the rest of the
+    set up still happens and it is returned at the end
+- otherwise, unless the device was left in (deep) standby, it calls
+    bmp581_wait_for_drdy to cause the rpi pico to wait until the first
+    sample is ready
 */
 extern enum bmp581_err_t bmp581_init(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_osr_t_t osr_t,
-    enum bmp581_osr_p_t osr_p)
+    enum bmp581_osr_p_t osr_p,
+    enum bmp581_pwr_mode_t pwr_mode,
+    enum bmp581_odr_t odr)
 {
     enum bmp581_err_t err;
+    enum bmp581_err_t odr_err = bmp581_err_ok;
     err = bmp581_check_powerup(i2c);
     if (err != bmp581_err_ok)
         return err;
-    err = bmp581_configure(i2c, osr_t, osr_p);
+    // ODR_CONFIG written by bmp581_configure starts the first sample
+    bmp581_drdy_flag = false;
+    err = bmp581_configure(i2c, osr_t, osr_p, pwr_mode, odr);
+    if (err == bmp581_err_odr_too_fast_for_osr)
+        odr_err = err;
+    else if (err != bmp581_err_ok)
+        return err;
+    if (bmp581_fifo_sel_val)
+    {
+        err = bmp581_write_fifo(i2c, bmp581_fifo_sel_val, bmp581_fifo_config_val);
+        if (err != bmp581_err_ok)
+            return err;
+    }
+    if (bmp581_drdy_gpio >= 0)
+    {
+        err = bmp581_configure_int(i2c);
+        if (err != bmp581_err_ok)
+            return err;
+    }
+    if (pwr_mode == bmp581_standby || pwr_mode == bmp581_deep_standby)
+        return odr_err;
+    err = bmp581_wait_for_drdy(i2c);
+    if (err != bmp581_err_ok)
+        return err;
+    return odr_err;
+}
+
+/*
+PRE:
+- bmp581_init was called and the most recent call was successful
+PURPOSE:
+- switches to pwr_mode at odr (see POWER MODES), keeping the oversampling
+    rates. The device is put into standby first, which also wakes it from
+    deep standby
+- returns bmp581_err_odr_too_fast_for_osr, like bmp581_configure, if odr is
+    too fast for the oversampling in normal mode; the mode is still changed
+*/
+extern enum bmp581_err_t bmp581_set_pwr_mode(
+    const i2c_device_t *i2c,
+    enum bmp581_pwr_mode_t pwr_mode,
+    enum bmp581_odr_t odr)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    uint8_t osr_config;
+    err = bmp581_reg_read_ex(i2c, bmp581_osr_config, &osr_config,
+                             bmp581_err_osr_config_set_addr_nack,
+                             bmp581_err_configs_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    err = bmp581_reg_write_ex(i2c, bmp581_odr_config,
+                              bmp581_odr_config_val(bmp581_standby, bmp581_odr_val),
+                              bmp581_err_configs_write_addr_nack,
+                              bmp581_err_configs_write_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    bmp581_wait_max();
+    return bmp581_configure(i2c, EXTRACT(osr_config, bmp581_osr_t),
+                            EXTRACT(osr_config, bmp581_osr_p), pwr_mode, odr);
+}
+
+/*
+PRE:
+- the device was put into forced mode by bmp581_init or bmp581_set_pwr_mode
+PURPOSE:
+- starts one measurement and waits until it is ready; the data is then read
+    with bmp581_read_press_handle_por or bmp581_read_press_temp_handle_por
+*/
+extern bmp581_eerr_t bmp581_measure_forced(const i2c_device_t *i2c)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    if (bmp581_pwr_mode_val != bmp581_forced)
+        return bmp581_err_not_forced_mode;
+    bmp581_drdy_flag = false;
+    err = bmp581_reg_write_ex(i2c, bmp581_odr_config,
+                              bmp581_odr_config_val(bmp581_forced, bmp581_odr_val),
+                              bmp581_err_configs_write_addr_nack,
+                              bmp581_err_configs_write_mismatch);
     if (err != bmp581_err_ok)
         return err;
     return bmp581_wait_for_drdy(i2c);
 }
 
+/*
+PURPOSE:
+- reads OSR_EFF: the oversampling rates the device really uses in normal
+    mode, and whether the configured ones fit the ODR period
+*/
+extern enum bmp581_err_t bmp581_read_osr_eff(
+    const i2c_device_t *i2c,
+    enum bmp581_osr_t_t *o_osr_t,
+    enum bmp581_osr_p_t *o_osr_p,
+    bool *o_odr_is_valid)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    uint8_t osr_eff;
+    err = bmp581_reg_read_ex(i2c, bmp581_osr_eff, &osr_eff,
+                             bmp581_err_osr_eff_set_addr_nack,
+                             bmp581_err_osr_eff_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    // same bit positions as in OSR_CONFIG
+    static_assert((int)bmp581_osr_t_eff == (int)bmp581_osr_t);
+    static_assert((int)bmp581_osr_p_eff == (int)bmp581_osr_p);
+    *o_osr_t = EXTRACT(osr_eff, bmp581_osr_t_eff);
+    *o_osr_p = EXTRACT(osr_eff, bmp581_osr_p_eff);
+    *o_odr_is_valid = FLAGGED(osr_eff, bmp581_odr_is_valid);
+    return bmp581_err_ok;
+}
+
+extern uint32_t bmp581_odr_millihz(enum bmp581_odr_t odr)
+{
+    if (odr > bmp581_odr_0_125_hz)
+        return 0;
+    return bmp581_odr_mhz[odr];
+}
+
+/*
+PRE:
+- bmp581_init was called and the most recent call was successful
+- INT is wired to gpio
+PURPOSE:
+- switches data ready detection from polling INT_STATUS to the INT pin
+    (see DATA READY INTERRUPT), then waits for the first interrupt so the
+    caller knows the wiring works. In forced mode a measurement is started
+    for it; in (deep) standby there is nothing to wait for
+*/
+extern enum bmp581_err_t bmp581_enable_drdy_irq(const i2c_device_t *i2c, unsigned int gpio)
+{
+    enum bmp581_err_t err;
+    gpio_init(gpio);
+    gpio_set_dir(gpio, GPIO_IN);
+    gpio_pull_down(gpio);
+    err = bmp581_configure_int(i2c);
+    if (err != bmp581_err_ok)
+        return err;
+    bmp581_drdy_gpio = gpio;
+    bmp581_drdy_flag = false;
+    gpio_add_raw_irq_handler(gpio, bmp581_drdy_isr);
+    gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    if (bmp581_pwr_mode_val == bmp581_standby ||
+        bmp581_pwr_mode_val == bmp581_deep_standby)
+        return bmp581_err_ok; // no sample to prove the wiring with
+    if (bmp581_pwr_mode_val == bmp581_forced)
+        err = bmp581_measure_forced(i2c);
+    else
+        err = bmp581_wait_for_drdy_irq();
+    if (err != bmp581_err_ok)
+    {
+        // fall back to polling, INT is probably not connected
+        gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_RISE, false);
+        gpio_remove_raw_irq_handler(gpio, bmp581_drdy_isr);
+        bmp581_drdy_gpio = -1;
+    }
+    return err;
+}
+
+/*
+PURPOSE:
+- returns true once for every sample signalled on INT since the last call,
+    with the time of the INT edge in o_time_us (may be NULL)
+- always false while data ready is polled
+*/
+extern bool bmp581_drdy_pending(uint64_t *o_time_us)
+{
+    bool pending = bmp581_drdy_flag;
+    if (!pending)
+        return false;
+    bmp581_drdy_flag = false;
+    if (o_time_us)
+        *o_time_us = bmp581_drdy_time_us;
+    return true;
+}
+
 /*
 PRE:
 - bmp581_configure or bmp581_handle_por called and the most recent call
@@ -558,9 +1013,10 @@ PURPOSE:
 - otherwise it reads and returns the pressure data
 */
 static enum bmp581_err_t bmp581_read_press(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     bmp581_press_t *o_press)
 {
+    I2C_SITE(__func__);
     static_assert(sizeof *o_press >= BMP581_NUM_PRESS_DATA_REGS);
     enum
     {
@@ -578,14 +1034,11 @@ static enum bmp581_err_t bmp581_read_press(
     // read PRESS_DATA_* and INT_STATUS.por
     // the por interrupt is always enabled
     // A read of the INT_STATUS will clear the status
-    bytes_moved = bmp581_set_reg_addr(i2c, start_reg, NONSTOP);
+    bytes_moved = bmp581_burst_read_timed(i2c, start_reg, bytes_to_read, reg_vals);
     if (bytes_moved == PICO_ERROR_GENERIC)
         return bmp581_err_press_data_set_addr_nack;
-    else if (bytes_moved != 1)
-        return bmp581_err_press_data_set_mismath;
-    bytes_moved = bmp581_burst_read(i2c, bytes_to_read, reg_vals);
-    if (bytes_moved == PICO_ERROR_GENERIC)
-        return bmp581_err_press_data_int_status_read_addr_nack;
+    if (bytes_moved == PICO_ERROR_TIMEOUT)
+        return bmp581_err_i2c_timeout;
     if (bytes_moved != bytes_to_read)
         return bmp581_err_press_data_int_status_read_mismatch;
     int_status = reg_vals[bmp581_int_status - start_reg];
@@ -603,6 +1056,53 @@ static enum bmp581_err_t bmp581_read_press(
     return bmp581_err_ok;
 }
 
+/*
+PRE:
+- same as bmp581_read_press
+PURPOSE:
+- same as bmp581_read_press, but starts the burst at TEMP_DATA_XLSB so the
+    temperature measured alongside the pressure comes back in the same
+    transaction: 11 bytes instead of 8, no extra START/address/register
+    phase
+*/
+static enum bmp581_err_t bmp581_read_press_temp(
+    const i2c_device_t *i2c,
+    bmp581_press_t *o_press,
+    bmp581_temp_t *o_temp)
+{
+    I2C_SITE(__func__);
+    enum
+    {
+        start_reg = bmp581_temp_data_xlsb,
+        end_reg = bmp581_int_status,
+        bytes_to_read = end_reg - start_reg + 1
+    };
+    static_assert(start_reg + bytes_to_read == end_reg + 1);
+    static_assert(bmp581_temp_data_msb + 1 == bmp581_press_data_xlsb);
+    uint8_t int_status;
+    uint8_t reg_vals[bytes_to_read];
+    int bytes_moved;
+    bytes_moved = bmp581_burst_read_timed(i2c, start_reg, bytes_to_read, reg_vals);
+    if (bytes_moved == PICO_ERROR_GENERIC)
+        return bmp581_err_press_data_set_addr_nack;
+    if (bytes_moved == PICO_ERROR_TIMEOUT)
+        return bmp581_err_i2c_timeout;
+    if (bytes_moved != bytes_to_read)
+        return bmp581_err_press_data_int_status_read_mismatch;
+    int_status = reg_vals[bmp581_int_status - start_reg];
+    if (FLAGGED(int_status, bmp581_por))
+        return bmp581_err_por;
+    *o_press =
+        reg_vals[bmp581_press_data_xlsb - start_reg] |
+        reg_vals[bmp581_press_data_lsb - start_reg] << BMP581_BITS_PER_BYTE |
+        reg_vals[bmp581_press_data_msb - start_reg] << BMP581_BITS_PER_BYTE * 2;
+    *o_temp = bmp581_sign_extend_24(
+        reg_vals[bmp581_temp_data_xlsb - start_reg] |
+        reg_vals[bmp581_temp_data_lsb - start_reg] << BMP581_BITS_PER_BYTE |
+        (long)reg_vals[bmp581_temp_data_msb - start_reg] << BMP581_BITS_PER_BYTE * 2);
+    return bmp581_err_ok;
+}
+
 /*
 PRE:
 - i2c_init has been called
@@ -611,8 +1111,9 @@ PURPOSE
 - resets the values of every register to their default and changed the
     mode of the device to deep standby
 */
-extern enum bmp581_err_t bmp581_soft_reset(i2c_inst_t *i2c)
+extern enum bmp581_err_t bmp581_soft_reset(const i2c_device_t *i2c)
 {
+    I2C_SITE(__func__);
     enum bmp581_err_t err;
     err = bmp581_reg_write_ex(i2c, bmp581_cmd, bmp581_cmd_soft_reset,
                               bmp581_err_cmd_write_addr_nack,
@@ -641,13 +1142,15 @@ PURPOSE:
 - if it still fails, it gives up and returns the error
 */
 static enum bmp581_err_t bmp581_handle_por(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     enum bmp581_osr_t_t osr_t,
     enum bmp581_osr_p_t osr_p)
 {
+    I2C_SITE(__func__);
     // try init the device again
     enum bmp581_err_t err;
-    if (bmp581_init(i2c, osr_t, osr_p) == bmp581_err_ok)
+    err = bmp581_init(i2c, osr_t, osr_p, bmp581_pwr_mode_val, bmp581_odr_val);
+    if (err == bmp581_err_ok || err == bmp581_err_odr_too_fast_for_osr)
         return bmp581_err_ok;
     /*under normal circumstances, bmp581_init should never fail since
     power-on-reset should reset registers to their defaults and change the
@@ -657,7 +1160,10 @@ static enum bmp581_err_t bmp581_handle_por(
     err = bmp581_soft_reset(i2c);
     if (err != bmp581_err_ok)
         return err;
-    return bmp581_init(i2c, osr_t, osr_p);
+    err = bmp581_init(i2c, osr_t, osr_p, bmp581_pwr_mode_val, bmp581_odr_val);
+    if (err == bmp581_err_odr_too_fast_for_osr)
+        return bmp581_err_ok;
+    return err;
 }
 
 /*
@@ -670,7 +1176,7 @@ PURPOSE:
 - otherwise,
 */
 extern bmp581_eerr_t bmp581_read_press_handle_por(
-    i2c_inst_t *i2c,
+    const i2c_device_t *i2c,
     bmp581_press_t *o_pressure,
     enum bmp581_osr_t_t osr_t,
     enum bmp581_osr_p_t osr_p)
@@ -680,9 +1186,165 @@ extern bmp581_eerr_t bmp581_read_press_handle_por(
     if (err != bmp581_err_por)
         return err;
     err = bmp581_handle_por(i2c, osr_t, osr_p);
-    if (err == bmp581_err_ok)
+    if (err != bmp581_err_ok)
+        return -err;
+    return bmp581_read_press(i2c, o_pressure);
+}
+
+/*
+PRE:
+- same as bmp581_read_press_handle_por
+PURPOSE:
+- same as bmp581_read_press_handle_por, additionally returning the
+    temperature from the same burst read (see bmp581_read_press_temp)
+*/
+extern bmp581_eerr_t bmp581_read_press_temp_handle_por(
+    const i2c_device_t *i2c,
+    bmp581_press_t *o_pressure,
+    bmp581_temp_t *o_temp,
+    enum bmp581_osr_t_t osr_t,
+    enum bmp581_osr_p_t osr_p)
+{
+    enum bmp581_err_t err;
+    err = bmp581_read_press_temp(i2c, o_pressure, o_temp);
+    if (err != bmp581_err_por)
+        return err;
+    err = bmp581_handle_por(i2c, osr_t, osr_p);
+    if (err != bmp581_err_ok)
+        return -err;
+    return bmp581_read_press_temp(i2c, o_pressure, o_temp);
+}
+
+/*
+PURPOSE:
+- returns time_us_64() at the end of the transaction that read the pressure
+    last returned by bmp581_read_press_handle_por or
+    bmp581_read_press_temp_handle_por
+*/
+extern uint64_t bmp581_read_time_us(void)
+{
+    return bmp581_read_us;
+}
+
+/*
+PRE:
+- bmp581_init was called and the most recent call was successful
+PURPOSE:
+- enables the FIFO (see FIFO MODE) for the given frame type. A threshold of
+    1 up to the FIFO depth makes INT pulse once that many frames are waiting
+    (when the data ready interrupt is in use); 0 leaves it per sample
+*/
+extern enum bmp581_err_t bmp581_fifo_enable(
+    const i2c_device_t *i2c,
+    enum bmp581_fifo_frame_t frame,
+    uint8_t threshold)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    size_t depth = frame == bmp581_fifo_press_temp ? BMP581_FIFO_MAX_FRAMES / 2
+                                                   : BMP581_FIFO_MAX_FRAMES;
+    if (frame == bmp581_fifo_disabled)
+        return bmp581_fifo_disable(i2c);
+    if (threshold > depth - 1)
+        threshold = depth - 1;
+    // stream-to-FIFO: on overflow the oldest frames are dropped
+    err = bmp581_write_fifo(i2c, frame, threshold);
+    if (err != bmp581_err_ok)
+        return err;
+    bmp581_fifo_sel_val = frame;
+    bmp581_fifo_config_val = threshold;
+    if (bmp581_drdy_gpio >= 0)
+        return bmp581_write_int_source(i2c, bmp581_int_source_sel());
+    return bmp581_err_ok;
+}
+
+extern enum bmp581_err_t bmp581_fifo_disable(const i2c_device_t *i2c)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    err = bmp581_write_fifo(i2c, bmp581_fifo_disabled, 0);
+    if (err != bmp581_err_ok)
+        return err;
+    bmp581_fifo_sel_val = 0;
+    bmp581_fifo_config_val = 0;
+    if (bmp581_drdy_gpio >= 0)
+        return bmp581_write_int_source(i2c, bmp581_int_source_sel());
+    return bmp581_err_ok;
+}
+
+/*
+PRE:
+- bmp581_fifo_enable was called and the most recent call was successful
+PURPOSE:
+- reads FIFO_COUNT, then every waiting frame (at most max_frames) in a single
+    burst of FIFO_DATA, and decodes them oldest first into o_frames
+- frames left in the FIFO because max_frames was too small are read by the
+    next call
+*/
+extern bmp581_eerr_t bmp581_fifo_read(
+    const i2c_device_t *i2c,
+    struct bmp581_fifo_frame_data_t *o_frames,
+    size_t max_frames,
+    size_t *o_count)
+{
+    I2C_SITE(__func__);
+    enum bmp581_err_t err;
+    uint8_t fifo_count;
+    uint8_t buf[BMP581_FIFO_MAX_FRAMES * BMP581_NUM_PRESS_DATA_REGS];
+    enum bmp581_fifo_frame_t frame =
+        EXTRACT(bmp581_fifo_sel_val, bmp581_fifo_frame_sel);
+    size_t frame_bytes = frame == bmp581_fifo_press_temp
+                             ? 2 * BMP581_NUM_PRESS_DATA_REGS
+                             : BMP581_NUM_PRESS_DATA_REGS;
+    size_t n;
+    *o_count = 0;
+    if (frame == bmp581_fifo_disabled)
+        return bmp581_err_fifo_disabled;
+    err = bmp581_reg_read_ex(i2c, bmp581_fifo_count, &fifo_count,
+                             bmp581_err_fifo_set_addr_nack,
+                             bmp581_err_fifo_read_mismatch);
+    if (err != bmp581_err_ok)
+        return err;
+    n = EXTRACT(fifo_count, bmp581_fifo_count_mask);
+    if (n > max_frames)
+        n = max_frames;
+    if (n > sizeof buf / frame_bytes)
+        n = sizeof buf / frame_bytes;
+    if (n == 0)
+        return bmp581_err_ok;
+    // FIFO_DATA does not auto-increment, every byte read pops the FIFO
+    err = bmp581_burst_read_ex(i2c, bmp581_fifo_data, n * frame_bytes, buf,
+                               bmp581_err_fifo_set_addr_nack,
+                               bmp581_err_fifo_read_mismatch);
+    if (err != bmp581_err_ok)
         return err;
-    return -bmp581_read_press(i2c, o_pressure);
+    for (size_t k = 0; k < n; k++)
+    {
+        const uint8_t *f = buf + k * frame_bytes;
+        long first = f[0] | (long)f[1] << BMP581_BITS_PER_BYTE |
+                     (long)f[2] << BMP581_BITS_PER_BYTE * 2;
+        o_frames[k].press = 0;
+        o_frames[k].temp = 0;
+        switch (frame)
+        {
+        case bmp581_fifo_temp:
+            o_frames[k].temp = bmp581_sign_extend_24(first);
+            break;
+        case bmp581_fifo_press:
+            o_frames[k].press = first;
+            break;
+        case bmp581_fifo_press_temp:
+            // temperature comes first in a P+T frame
+            o_frames[k].temp = bmp581_sign_extend_24(first);
+            o_frames[k].press = f[3] | (long)f[4] << BMP581_BITS_PER_BYTE |
+                                (long)f[5] << BMP581_BITS_PER_BYTE * 2;
+            break;
+        default:
+            break;
+        }
+    }
+    *o_count = n;
+    return bmp581_err_ok;
 }
 
 extern struct bmp581_pressure_t bmp581_decode_press(bmp581_press_t press)
@@ -695,6 +1357,12 @@ extern struct bmp581_pressure_t bmp581_decode_press(bmp581_press_t press)
     return pressure;
 }
 
+// temperature in hundredths of a degree, rounded towards zero
+extern long bmp581_decode_temp_centi(bmp581_temp_t temp)
+{
+    return temp * 100 / (1l << BMP581_TEMP_RADIX_BIT_POS);
+}
+
 #if BMP581_ENABLE_DECODE_PRESSF
 extern float bmp581_decode_pressf(bmp581_press_t press)
 {
@@ -1,12 +1,17 @@
 #ifndef BMP581_H
 #define BMP581_H
-#include "hardware/i2c.h"
+#include "i2c_device.h"
+#include <assert.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <limits.h>
 #include <stdio.h>
 
 
 #define BMP581_ENABLE_DECODE_PRESSF 0
+#define BMP581_I2C_SLAVE_ADDR 0x47 // due to ADR jumper
+#define BMP581_I2C_MAX_HZ 3400000  // Hs-mode; the RP2350 stops at 1 MHz
+#define BMP581_I2C_ID_REG 0x01     // CHIP_ID
 #define BMP581_NUM_PRESS_DATA_REGS 3
 
 #define BMP581_STR_IMPL(X) #X
@@ -63,8 +68,31 @@ enum bmp581_err_t {
     bmp581_err_int_status_set_mismatch,
     bmp581_err_int_status_read_addr_nack,
     bmp581_err_int_status_read_mismatch,
+    bmp581_err_int_config_set_addr_nack,
+    bmp581_err_int_config_set_mismatch,
+    bmp581_err_int_config_read_addr_nack,
+    bmp581_err_int_config_read_mismatch,
+    bmp581_err_int_config_write_addr_nack,
+    bmp581_err_int_config_write_mismatch,
+    bmp581_err_opposing_int_config_read,
+    bmp581_err_fifo_set_addr_nack,
+    bmp581_err_fifo_set_mismatch,
+    bmp581_err_fifo_read_addr_nack,
+    bmp581_err_fifo_read_mismatch,
+    bmp581_err_fifo_write_addr_nack,
+    bmp581_err_fifo_write_mismatch,
+    bmp581_err_opposing_fifo_read,
+    bmp581_err_fifo_disabled,
+    bmp581_err_osr_eff_set_addr_nack,
+    bmp581_err_osr_eff_set_mismatch,
+    bmp581_err_osr_eff_read_addr_nack,
+    bmp581_err_osr_eff_read_mismatch,
+    bmp581_err_odr_too_fast_for_osr,
+    bmp581_err_deep_standby_fifo_enabled,
+    bmp581_err_not_forced_mode,
     bmp581_max_err_val,
-    bmp581_err_drdy_timeout
+    bmp581_err_drdy_timeout,
+    bmp581_err_i2c_timeout // the I2C engine gave up on the transaction
 };
 
 enum bmp581_osr_t_t {
@@ -89,30 +117,139 @@ enum bmp581_osr_p_t {
     bmp581_osr_p_128x = bmp581_osr_t_128x << 3
 };
 
+enum bmp581_pwr_mode_t {
+    bmp581_standby      = 0b00,
+    bmp581_normal       = 0b01,
+    bmp581_forced       = 0b10,
+    bmp581_nonstop      = 0b11,  // aka continuous mode
+    bmp581_deep_standby = 0b100  // standby with ODR_CONFIG.deep_dis = 0
+};
+
+// ODR_CONFIG.odr, the sample rate in normal mode
+enum bmp581_odr_t {
+    bmp581_odr_240_hz   = 0x00,
+    bmp581_odr_218_5_hz = 0x01,
+    bmp581_odr_199_1_hz = 0x02,
+    bmp581_odr_179_2_hz = 0x03,
+    bmp581_odr_160_hz   = 0x04,
+    bmp581_odr_149_3_hz = 0x05,
+    bmp581_odr_140_hz   = 0x06,
+    bmp581_odr_129_8_hz = 0x07,
+    bmp581_odr_120_hz   = 0x08,
+    bmp581_odr_110_1_hz = 0x09,
+    bmp581_odr_100_2_hz = 0x0A,
+    bmp581_odr_89_6_hz  = 0x0B,
+    bmp581_odr_80_hz    = 0x0C,
+    bmp581_odr_70_hz    = 0x0D,
+    bmp581_odr_60_hz    = 0x0E,
+    bmp581_odr_50_hz    = 0x0F,
+    bmp581_odr_45_hz    = 0x10,
+    bmp581_odr_40_hz    = 0x11,
+    bmp581_odr_35_hz    = 0x12,
+    bmp581_odr_30_hz    = 0x13,
+    bmp581_odr_25_hz    = 0x14,
+    bmp581_odr_20_hz    = 0x15,
+    bmp581_odr_15_hz    = 0x16,
+    bmp581_odr_10_hz    = 0x17,
+    bmp581_odr_5_hz     = 0x18,
+    bmp581_odr_4_hz     = 0x19,
+    bmp581_odr_3_hz     = 0x1A,
+    bmp581_odr_2_hz     = 0x1B,
+    bmp581_odr_1_hz     = 0x1C,
+    bmp581_odr_0_5_hz   = 0x1D,
+    bmp581_odr_0_25_hz  = 0x1E,
+    bmp581_odr_0_125_hz = 0x1F
+};
+
 typedef long bmp581_press_t;
+typedef long bmp581_temp_t; // degC, 16 fractional bits, sign extended
+
+#define BMP581_FIFO_MAX_FRAMES 32
+
+enum bmp581_fifo_frame_t {
+    bmp581_fifo_disabled   = 0b00,
+    bmp581_fifo_temp       = 0b01,
+    bmp581_fifo_press      = 0b10,
+    bmp581_fifo_press_temp = 0b11
+};
+
+struct bmp581_fifo_frame_data_t {
+    bmp581_press_t press; // raw, as bmp581_read_press_handle_por returns
+    bmp581_temp_t temp;   // raw, degC with 16 fractional bits
+};
 
 typedef int8_t bmp581_eerr_t;
 static_assert(bmp581_max_err_val <= 2 << sizeof(bmp581_eerr_t) * 8);
 
 extern enum bmp581_err_t bmp581_init(
-    i2c_inst_t* i2c, 
+    const i2c_device_t *i2c, 
     enum bmp581_osr_t_t osr_t, 
-    enum bmp581_osr_p_t osr_p
+    enum bmp581_osr_p_t osr_p,
+    enum bmp581_pwr_mode_t pwr_mode,
+    enum bmp581_odr_t odr
+);
+
+extern enum bmp581_err_t bmp581_set_pwr_mode(
+    const i2c_device_t *i2c,
+    enum bmp581_pwr_mode_t pwr_mode,
+    enum bmp581_odr_t odr
+);
+
+extern bmp581_eerr_t bmp581_measure_forced(const i2c_device_t *i2c);
+
+extern enum bmp581_err_t bmp581_read_osr_eff(
+    const i2c_device_t *i2c,
+    enum bmp581_osr_t_t *o_osr_t,
+    enum bmp581_osr_p_t *o_osr_p,
+    bool *o_odr_is_valid
 );
 
+extern uint32_t bmp581_odr_millihz(enum bmp581_odr_t odr);
+
 extern bmp581_eerr_t bmp581_read_press_handle_por(
-    i2c_inst_t* i2c, 
+    const i2c_device_t *i2c, 
     long* o_press,
     enum bmp581_osr_t_t osr_t, 
     enum bmp581_osr_p_t osr_p
 );
 
+extern bmp581_eerr_t bmp581_read_press_temp_handle_por(
+    const i2c_device_t *i2c,
+    bmp581_press_t* o_press,
+    bmp581_temp_t* o_temp,
+    enum bmp581_osr_t_t osr_t,
+    enum bmp581_osr_p_t osr_p
+);
+
+extern uint64_t bmp581_read_time_us(void);
+
 extern struct bmp581_pressure_t bmp581_decode_press(bmp581_press_t press);
 
+extern long bmp581_decode_temp_centi(bmp581_temp_t temp);
+
 #if BMP581_ENABLE_DECODE_PRESSF
 extern float bmp581_decode_pressf(bmp581_press_t press);
 #endif
 
-extern enum bmp581_err_t bmp581_soft_reset(i2c_inst_t * i2c);
+extern enum bmp581_err_t bmp581_soft_reset(const i2c_device_t *i2c);
+
+extern enum bmp581_err_t bmp581_enable_drdy_irq(const i2c_device_t *i2c, unsigned int gpio);
+
+extern bool bmp581_drdy_pending(uint64_t *o_time_us);
+
+extern enum bmp581_err_t bmp581_fifo_enable(
+    const i2c_device_t *i2c,
+    enum bmp581_fifo_frame_t frame,
+    uint8_t threshold
+);
+
+extern enum bmp581_err_t bmp581_fifo_disable(const i2c_device_t *i2c);
+
+extern bmp581_eerr_t bmp581_fifo_read(
+    const i2c_device_t *i2c,
+    struct bmp581_fifo_frame_data_t *o_frames,
+    size_t max_frames,
+    size_t *o_count
+);
 
 #endif
\ No newline at end of file
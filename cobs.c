@@ -0,0 +1,51 @@
+#include "cobs.h"
+
+/*
+PURPOSE:
+- every run of up to 254 non-zero bytes is preceded by a code byte: the
+    run's length + 1. A code below 0xFF also stands for the zero that ended
+    the run; the implicit zero after the last run is not part of the data
+*/
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t out = 1;
+    size_t code_at = 0;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (src[i] != 0)
+        {
+            dst[out++] = src[i];
+            code++;
+        }
+        if (src[i] == 0 || code == 0xFF)
+        {
+            dst[code_at] = code;
+            code_at = out++;
+            code = 1;
+        }
+    }
+    dst[code_at] = code;
+    return out;
+}
+
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < len)
+    {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > len)
+            return 0;
+        for (uint8_t k = 1; k < code; k++)
+        {
+            if (src[in] == 0)
+                return 0;
+            dst[out++] = src[in++];
+        }
+        if (code != 0xFF && in < len)
+            dst[out++] = 0;
+    }
+    return out;
+}
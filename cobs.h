@@ -0,0 +1,33 @@
+/*
+CONSISTENT OVERHEAD BYTE STUFFING (COBS)
+- cobs_encode rewrites a buffer so it contains no zero byte, at a cost of one
+    byte per 254 plus one; a zero byte then marks the end of every frame, and
+    a receiver that loses its place resynchronises at the next one
+- neither function writes the zero delimiter or expects it in src
+tools/stream_recv decodes with cobs.c itself, so a receiver and the firmware
+never disagree about the encoding.
+*/
+#ifndef COBS_H
+#define COBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// longest encoding of len bytes
+#define COBS_MAX_ENCODED(LEN) ((LEN) + (LEN) / 254 + 1)
+
+// PRE: dst has room for COBS_MAX_ENCODED(len) bytes. Returns the encoded length
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+// PRE: dst has room for len bytes. Returns the decoded length, or 0 if src
+// is not a valid encoding (a zero byte, a code past the end)
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,56 +1,187 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
-#include "hardware/i2c.h"
 #include <stdint.h>
+#include "compass.h"
+#include "trace.h"
 
-#define I2C_PORT i2c0
-#define SDA_PIN 4
-#define SCL_PIN 5
-
-#define CMPS12_ADDRESS 0x60
 #define ANGLE_8 1  // Register for 8-bit angle
+#define BEARING_16 2 // Register for 16-bit angle, high byte first
+
+/*
+READ PROFILES
+- heading:  registers 2-3, the 16-bit bearing only (2 bytes)
+- attitude: registers 1-5, 8 and 16-bit bearing, pitch and roll (5 bytes)
+- full:     registers 1-30 in one transaction, adding raw magnetometer,
+    accelerometer and gyro (16-bit, high byte first), temperature, the
+    BNO055 16-bit bearing, 16-bit pitch and the calibration state
+- every read is one transaction; the profile only sets where it starts and
+    how long it is, so pick the richest one the bus budget allows
+    (compass_profile_for_budget)
+*/
+#define FULL_LEN 30
 
-uint8_t high_byte, low_byte, angle8;
-int8_t pitch, roll;
-uint16_t angle16;
+static const struct {
+    uint8_t reg;
+    uint8_t len;
+} PROFILES[] = {
+    [compass_profile_heading] = {BEARING_16, 2},
+    [compass_profile_attitude] = {ANGLE_8, 5},
+    [compass_profile_full] = {ANGLE_8, FULL_LEN},
+};
+
+static compass_data_t compass_data;
 
 // ---------------------------------------------
 // Convert angle (0–359) into cardinal direction
 // ---------------------------------------------
+// 16 bins of 22.5°, centred on N: bin = round(angle / 22.5), done in tenths
+// of a degree so it stays integer (no FPU on the Hazard3 cores)
+int compass_heading_bin(int angle_tenths) {
+    return ((angle_tenths + 112) / 225) % 16;
+}
+
 const char* getCardinalDirection(int angle) {
     static const char* directions[] = {
         "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE",
         "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW"
     };
 
-    int index = (int)((angle / 22.5f) + 0.5f);
-    return directions[index % 16];
+    return directions[compass_heading_bin(angle * 10)];
 }
 
-int read_compass() {
-        uint8_t reg = ANGLE_8;
+static uint8_t compass_reg = ANGLE_8;
+static uint8_t compass_buf[FULL_LEN];
+static enum compass_profile_t compass_profile = compass_profile_attitude;
+static const i2c_device_t *compass_dev;
+static i2c_txn_t compass_txn = {
+    .wr = &compass_reg,
+    .wr_len = 1,
+    .rd = compass_buf,
+    .rd_len = 5,
+    .site = "read_compass",
+};
 
-        // Tell CMPS12 which register to start reading
-        i2c_write_blocking(I2C_PORT, CMPS12_ADDRESS, &reg, 1, true);
+// The CMPS12 needs no setup; this only says where it is
+void compass_init(const i2c_device_t *dev) {
+    compass_dev = dev;
+}
 
-        // Read 5 bytes: angle8, high, low, pitch, roll
-        uint8_t buf[5];
-        i2c_read_blocking(I2C_PORT, CMPS12_ADDRESS, buf, 5, false);
+// PRE: no read in flight
+void compass_set_profile(enum compass_profile_t profile) {
+    compass_profile = profile;
+    compass_reg = PROFILES[profile].reg;
+    compass_txn.rd_len = PROFILES[profile].len;
+}
 
-        angle8 = buf[0];
-        high_byte = buf[1];
-        low_byte  = buf[2];
-        pitch = (int8_t)buf[3];
-        roll  = (int8_t)buf[4];
+enum compass_profile_t compass_get_profile(void) {
+    return compass_profile;
+}
+
+// Bus time of one read in a profile: address + register, repeated start,
+// address + data, 9 clocks a byte plus start, restart and stop
+uint32_t compass_profile_bus_us(enum compass_profile_t profile, uint32_t bus_hz) {
+    uint32_t clocks = (3 + PROFILES[profile].len) * 9 + 3;
+    return (uint32_t)(((uint64_t)clocks * 1000000 + bus_hz - 1) / bus_hz);
+}
 
-        angle16 = ((uint16_t)high_byte << 8) | low_byte;
+// The richest profile whose reads, one every period_us, keep the compass
+// within budget_us of bus time per second
+enum compass_profile_t compass_profile_for_budget(uint32_t bus_hz, uint32_t period_us,
+                                                  uint32_t budget_us) {
+    enum compass_profile_t profile = compass_profile_full;
+    while (profile > compass_profile_heading &&
+           (uint64_t)compass_profile_bus_us(profile, bus_hz) * 1000000 / period_us > budget_us)
+        profile--;
+    return profile;
+}
 
-        int angle_deg = angle16 / 10;  // Convert to integer degrees
+// Queue the read; the bytes arrive by DMA while the caller does other work
+bool read_compass_start(void) {
+        return i2c_device_submit(compass_dev, &compass_txn);
+}
+
+static int16_t be16(const uint8_t *p) {
+    return (int16_t)((uint16_t)p[0] << 8 | p[1]);
+}
 
-        printf("roll: %d    pitch: %d    angle8: %d    angle16: %d.%d    ",
-               roll, pitch, angle8, angle16 / 10, angle16 % 10);
+// Wait for the read queued by read_compass_start and decode it
+int read_compass_finish(void) {
+        if (i2c_device_wait(compass_dev, &compass_txn) != i2c_txn_done) {
+            TRACE_WARN("compass read failed");
+            return -1;
+        }
 
-        printf("cardinal: %s\n", getCardinalDirection(angle_deg));
+        uint8_t *buf = compass_buf;
+        compass_data_t *d = &compass_data;
+
+        d->profile = compass_profile;
+        if (compass_profile == compass_profile_heading) {
+            // 2 bytes: high, low
+            d->bearing_tenths = (uint16_t)be16(buf);
+            return d->bearing_tenths / 10;
+        }
+
+        // 5 bytes: angle8, high, low, pitch, roll
+        d->bearing8 = buf[0];
+        d->bearing_tenths = (uint16_t)be16(buf + 1);
+        d->pitch = (int8_t)buf[3];
+        d->roll  = (int8_t)buf[4];
+
+        if (compass_profile == compass_profile_full) {
+            // register n is buf[n - 1]
+            for (int k = 0; k < 3; k++) {
+                d->mag[k] = be16(buf + 5 + 2 * k);
+                d->accel[k] = be16(buf + 11 + 2 * k);
+                d->gyro[k] = be16(buf + 17 + 2 * k);
+            }
+            d->temperature = be16(buf + 23);
+            d->bearing_bno = (uint16_t)be16(buf + 25);
+            d->pitch16 = be16(buf + 27);
+            d->calibration = buf[29];
+        }
+
+        int angle_deg = d->bearing_tenths / 10;  // Convert to integer degrees
 
     return angle_deg;
 }
+
+// Everything decoded by the last read_compass_finish; d->profile says which
+// fields are current
+const compass_data_t *compass_latest(void) {
+    return &compass_data;
+}
+
+// When the read behind the last read_compass_finish completed
+uint64_t read_compass_time_us(void) {
+        return compass_txn.complete_us;
+}
+
+// Trace the values decoded by the last read_compass_finish; the cardinal
+// name is a string constant, so it goes by address like the rest
+void print_compass(void) {
+        const compass_data_t *d = &compass_data;
+        if (d->profile != compass_profile_heading)
+            TRACE_INFO("roll: %d    pitch: %d    angle8: %d    angle16: %d.%d    cardinal: %s",
+                       d->roll, d->pitch, d->bearing8, d->bearing_tenths / 10,
+                       d->bearing_tenths % 10, getCardinalDirection(d->bearing_tenths / 10));
+        else
+            TRACE_INFO("angle16: %d.%d    cardinal: %s", d->bearing_tenths / 10,
+                       d->bearing_tenths % 10, getCardinalDirection(d->bearing_tenths / 10));
+
+        if (d->profile == compass_profile_full) {
+            TRACE_DEBUG("mag: %d %d %d    accel: %d %d %d",
+                        d->mag[0], d->mag[1], d->mag[2], d->accel[0], d->accel[1],
+                        d->accel[2]);
+            TRACE_DEBUG("gyro: %d %d %d    pitch16: %d    temp: %d",
+                        d->gyro[0], d->gyro[1], d->gyro[2], d->pitch16, d->temperature);
+            TRACE_DEBUG("cal: sys %d gyro %d accel %d mag %d",
+                        d->calibration >> 6 & 3, d->calibration >> 4 & 3,
+                        d->calibration >> 2 & 3, d->calibration & 3);
+        }
+}
+
+int read_compass() {
+        if (!read_compass_start())
+            return -1;
+        return read_compass_finish();
+}
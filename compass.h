@@ -1,6 +1,51 @@
 #ifndef COMPASS_H
 #define COMPASS_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "i2c_device.h"
+
+#define CMPS12_ADDRESS 0x60
+#define CMPS12_MAX_HZ 400000
+#define CMPS12_ID_REG 0x00 // software version
+
+enum compass_profile_t {
+    compass_profile_heading,  // 16-bit bearing only
+    compass_profile_attitude, // bearings, pitch and roll
+    compass_profile_full      // everything up to the calibration state
+};
+
+typedef struct {
+    enum compass_profile_t profile; // profile of the read that filled this
+    // all profiles
+    uint16_t bearing_tenths; // 0-3599
+    // attitude and full
+    uint8_t bearing8;        // 0-255
+    int8_t pitch;            // degrees, +/-90
+    int8_t roll;             // degrees, +/-90
+    // full only
+    int16_t mag[3];          // raw x, y, z
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t temperature;     // degC
+    uint16_t bearing_bno;    // BNO055 bearing, 1/16 degree (0-5759)
+    int16_t pitch16;         // degrees, +/-180
+    uint8_t calibration;     // 2 bits each: sys, gyro, accel, mag (3 = calibrated)
+} compass_data_t;
+
 int read_compass();
+void compass_init(const i2c_device_t *dev);
+void compass_set_profile(enum compass_profile_t profile);
+enum compass_profile_t compass_get_profile(void);
+uint32_t compass_profile_bus_us(enum compass_profile_t profile, uint32_t bus_hz);
+enum compass_profile_t compass_profile_for_budget(uint32_t bus_hz, uint32_t period_us,
+                                                  uint32_t budget_us);
+const compass_data_t *compass_latest(void);
+bool read_compass_start(void);
+int read_compass_finish(void);
+void print_compass(void);
+uint64_t read_compass_time_us(void);
+int compass_heading_bin(int angle_tenths);
+const char* getCardinalDirection(int angle);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+/*
+CRC-32
+- the IEEE 802.3 / zlib CRC (reflected polynomial 0xEDB88320, initial value
+    and final XOR 0xFFFFFFFF), table driven, one byte per step
+- crc32(0, buf, len) checks one buffer; feeding the result back in as crc
+    continues it over the next one, as zlib's crc32 does
+tools/log_decode and tools/stream_recv link crc32.c itself, and stream_recv
+checks it against CRC32_CHECK before trusting a packet.
+*/
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC32_CHECK 0xCBF43926u // crc32(0, "123456789", 9)
+
+uint32_t crc32(uint32_t crc, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
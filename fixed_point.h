@@ -0,0 +1,57 @@
+/*
+FIXED-POINT BUILD
+- the RP2350's Hazard3 RISC-V cores have no FPU, so every float operation
+    there is a soft-float library call. SENSORS_FIXED_POINT=1 (CMake option
+    of the same name) switches the per-sample processing and encoding path
+    to integers:
+    - UV index as Q16 (uv_index_t), computed by veml6075_snapshot_index_q16
+    - pressure stays the raw BMP581 value, printed with bmp581_decode_press
+    - compass heading bins are integer in both builds
+    - log records store the UV index as a Q16 channel; the file header says
+        so, so tools/log_decode handles either build
+- the float build (default) is unchanged
+This header is shared with the host tools in tools/ through log_format.h.
+*/
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+#ifndef SENSORS_FIXED_POINT
+#define SENSORS_FIXED_POINT 0
+#endif
+
+#define Q16_FRAC_BITS 16
+#define Q16_ONE (1l << Q16_FRAC_BITS)
+
+typedef int32_t q16_t;
+
+#if SENSORS_FIXED_POINT
+typedef q16_t uv_index_t;
+#else
+typedef float uv_index_t;
+#endif
+
+// integer part of |q|; print the sign separately (Q16_SIGN), since -0.5
+// has an integer part of 0
+static inline unsigned long q16_int(q16_t q)
+{
+    return (unsigned long)((q < 0 ? -(int64_t)q : q) >> Q16_FRAC_BITS);
+}
+
+// first `digits` decimal digits of the fraction of |q|, for "%lu.%0*lu"
+static inline unsigned long q16_frac(q16_t q, unsigned int digits)
+{
+    uint64_t frac = (q < 0 ? -(int64_t)q : q) & (Q16_ONE - 1);
+    uint64_t scale = 1;
+    while (digits--)
+        scale *= 10;
+    return (unsigned long)(frac * scale >> Q16_FRAC_BITS);
+}
+
+#define Q16_SIGN(Q) ((Q) < 0 ? "-" : "")
+
+// digits that tell Q16 values apart (2^-16 = 0.0000153)
+#define Q16_DECIMALS 5
+
+#endif
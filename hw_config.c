@@ -123,6 +123,8 @@ static sd_spi_if_t sd_spi_if = {
 
 // ----------------------------
 // SD card descriptor
+// only ever touched from core1 (see logging.c), which mounts the card and
+// therefore also owns the SPI DMA interrupts
 // ----------------------------
 static sd_card_t sd_card = {
     .type = SD_IF_SPI,
@@ -0,0 +1,90 @@
+#include "i2c_device.h"
+#include <string.h>
+
+// txn->addr, txn->timeout_us and txn->hz come from the descriptor
+bool i2c_device_submit(const i2c_device_t *dev, i2c_txn_t *txn)
+{
+    txn->addr = dev->addr;
+    txn->timeout_us = dev->timeout_us;
+    txn->hz = dev->hz;
+    return i2c_engine_submit(dev->bus, txn);
+}
+
+enum i2c_txn_status_t i2c_device_wait(const i2c_device_t *dev, i2c_txn_t *txn)
+{
+    return i2c_engine_wait(dev->bus, txn);
+}
+
+int i2c_device_transfer(const i2c_device_t *dev, i2c_txn_t *txn)
+{
+    txn->addr = dev->addr;
+    txn->timeout_us = dev->timeout_us;
+    txn->hz = dev->hz;
+    return i2c_engine_transfer(dev->bus, txn);
+}
+
+int i2c_device_write_read(const i2c_device_t *dev, const uint8_t *wr, size_t wr_len,
+                          uint8_t *rd, size_t rd_len, uint64_t *o_complete_us)
+{
+    i2c_txn_t txn = {
+        .wr = wr,
+        .wr_len = (uint16_t)wr_len,
+        .rd = rd,
+        .rd_len = (uint16_t)rd_len};
+    int ret = i2c_device_transfer(dev, &txn);
+    if (o_complete_us)
+        *o_complete_us = txn.complete_us;
+    return ret;
+}
+
+int i2c_device_write(const i2c_device_t *dev, const uint8_t *src, size_t len)
+{
+    return i2c_device_write_read(dev, src, len, NULL, 0, NULL);
+}
+
+static bool i2c_device_read_id(const i2c_device_t *dev, uint32_t hz, uint8_t *o_id)
+{
+    i2c_txn_t txn = {
+        .addr = dev->addr,
+        .wr = &dev->id_reg,
+        .wr_len = 1,
+        .rd = o_id,
+        .rd_len = dev->id_len,
+        .timeout_us = dev->timeout_us,
+        .hz = hz};
+    return i2c_engine_transfer(dev->bus, &txn) == dev->id_len;
+}
+
+/*
+PRE:
+- rates is sorted fastest first; the last one is a clock every part on the
+    bus works at
+PURPOSE:
+- reads the ID register at the last rate, then at every rate the device is
+    rated for, fastest first, I2C_DEVICE_PROBE_READS times each; the first
+    rate at which every read succeeds and matches becomes dev->hz
+- returns dev->hz, or 0 (leaving dev->hz alone) if the device does not
+    answer even at the last rate
+*/
+uint32_t i2c_device_probe_hz(i2c_device_t *dev, const uint32_t *rates, size_t num_rates)
+{
+    I2C_SITE(__func__);
+    uint8_t ref[4];
+    uint8_t id[4];
+    uint32_t base;
+    if (num_rates == 0 || dev->id_len == 0 || dev->id_len > sizeof ref)
+        return 0;
+    base = rates[num_rates - 1];
+    if (!i2c_device_read_id(dev, base, ref))
+        return 0;
+    for (size_t r = 0; r + 1 < num_rates; r++)
+    {
+        bool ok = rates[r] <= dev->max_hz;
+        for (int k = 0; ok && k < I2C_DEVICE_PROBE_READS; k++)
+            ok = i2c_device_read_id(dev, rates[r], id) &&
+                 memcmp(id, ref, dev->id_len) == 0;
+        if (ok)
+            return dev->hz = rates[r];
+    }
+    return dev->hz = base;
+}
@@ -0,0 +1,61 @@
+/*
+I2C DEVICES
+- drivers talk to their part through an i2c_device_t: the bus (an I2C
+    engine), the 7-bit address and how long a transaction may take. They no
+    longer pick an I2C instance or address themselves, so the same driver
+    runs on either Pico bus or on a host bus (tools/)
+- main builds one descriptor per part once the bus exists and hands it to
+    the driver's init
+- transfers are I2C engine transactions: i2c_device_transfer queues one
+    and waits, i2c_device_submit only queues it (for drivers that overlap
+    bus time with work); the timeout is the descriptor's
+- every descriptor carries the part's datasheet clock limit and a register
+    that never changes (its ID). i2c_device_probe_hz reads that register at
+    falling clocks and settles on the fastest one it reads back correctly;
+    the device's transactions then run at that clock (see the clock
+    switching in i2c_engine.h)
+This file is plain C with no Pico SDK dependency.
+*/
+#ifndef I2C_DEVICE_H
+#define I2C_DEVICE_H
+
+#include "i2c_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_DEVICE_PROBE_READS 8 // reads that must all match at a probed clock
+
+typedef struct
+{
+    const char *name;
+    i2c_engine_t *bus;
+    uint8_t addr;
+    uint32_t timeout_us; // per transaction; 0 selects I2C_ENGINE_DEFAULT_TIMEOUT_US
+    uint32_t max_hz;     // fastest SCL in the datasheet
+    uint8_t id_reg;      // a read-only register with a fixed value, for probing
+    uint8_t id_len;
+    uint32_t hz;         // SCL its transactions run at; 0 selects the bus default
+} i2c_device_t;
+
+#define I2C_DEVICE(NAME, ADDR, MAX_HZ, ID_REG, ID_LEN)                  \
+    {                                                                    \
+        .name = NAME, .addr = ADDR, .max_hz = MAX_HZ, .id_reg = ID_REG, \
+        .id_len = ID_LEN                                                 \
+    }
+
+bool i2c_device_submit(const i2c_device_t *dev, i2c_txn_t *txn);
+enum i2c_txn_status_t i2c_device_wait(const i2c_device_t *dev, i2c_txn_t *txn);
+// as i2c_engine_transfer: bytes moved or an I2C_ENGINE_ERR_* code
+int i2c_device_transfer(const i2c_device_t *dev, i2c_txn_t *txn);
+int i2c_device_write_read(const i2c_device_t *dev, const uint8_t *wr, size_t wr_len,
+                          uint8_t *rd, size_t rd_len, uint64_t *o_complete_us);
+int i2c_device_write(const i2c_device_t *dev, const uint8_t *src, size_t len);
+uint32_t i2c_device_probe_hz(i2c_device_t *dev, const uint32_t *rates, size_t num_rates);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
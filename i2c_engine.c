@@ -0,0 +1,253 @@
+#include "i2c_engine.h"
+
+#define QUEUE_MASK (I2C_ENGINE_QUEUE_LEN - 1)
+_Static_assert((I2C_ENGINE_QUEUE_LEN & QUEUE_MASK) == 0,
+               "I2C_ENGINE_QUEUE_LEN must be a power of two");
+
+const char *i2c_engine_site;
+
+void i2c_engine_init(i2c_engine_t *eng, const i2c_engine_backend_t *backend,
+                     void *ctx)
+{
+    *eng = (i2c_engine_t){.backend = backend, .ctx = ctx};
+    eng->profile_us = backend->now_us(ctx);
+}
+
+// PRE: engine locked, bus idle
+static void i2c_engine_switch_hz(i2c_engine_t *eng, uint32_t hz)
+{
+    if (hz == 0 || hz == eng->hz || eng->backend->set_hz == NULL)
+        return;
+    eng->backend->set_hz(eng->ctx, hz);
+    if (eng->hz != 0)
+        eng->stats.hz_switches++;
+    eng->hz = hz;
+}
+
+// PRE: engine locked, bus idle
+static void i2c_engine_start(i2c_engine_t *eng, i2c_txn_t *txn)
+{
+    i2c_engine_switch_hz(eng, txn->hz ? txn->hz : eng->default_hz);
+    eng->active = txn;
+    txn->status = i2c_txn_busy;
+    txn->start_us = eng->backend->now_us(eng->ctx);
+    eng->backend->start(eng->ctx, txn);
+}
+
+bool i2c_engine_submit(i2c_engine_t *eng, i2c_txn_t *txn)
+{
+    uint32_t saved;
+    if (txn->wr_len + txn->rd_len == 0 ||
+        txn->wr_len + txn->rd_len > I2C_ENGINE_MAX_XFER)
+        return false;
+    if (txn->timeout_us == 0)
+        txn->timeout_us = I2C_ENGINE_DEFAULT_TIMEOUT_US;
+    saved = eng->backend->lock(eng->ctx);
+    if (((eng->head - eng->tail) & 0xFF) == I2C_ENGINE_QUEUE_LEN)
+    {
+        eng->stats.queue_full++;
+        eng->backend->unlock(eng->ctx, saved);
+        return false;
+    }
+    eng->stats.submitted++;
+    if (txn->site == NULL)
+        txn->site = i2c_engine_site;
+    txn->status = i2c_txn_queued;
+    if (eng->active == NULL)
+        i2c_engine_start(eng, txn);
+    else
+        eng->queue[eng->head++ & QUEUE_MASK] = txn;
+    eng->backend->unlock(eng->ctx, saved);
+    return true;
+}
+
+// PRE: engine locked
+static void i2c_engine_profile_txn(i2c_engine_t *eng, const i2c_txn_t *txn,
+                                   enum i2c_txn_status_t status)
+{
+    uint32_t us = (uint32_t)(txn->complete_us - txn->start_us);
+    i2c_site_stats_t *s = eng->sites;
+    i2c_site_stats_t *end = eng->sites + eng->num_sites;
+    while (s < end && (s->addr != txn->addr || s->site != txn->site))
+        s++;
+    if (s == end)
+    {
+        if (eng->num_sites == I2C_ENGINE_PROFILE_SITES)
+        {
+            eng->sites_full++;
+            return;
+        }
+        eng->num_sites++;
+        *s = (i2c_site_stats_t){.addr = txn->addr, .site = txn->site};
+    }
+    s->txns++;
+    s->bus_us += us;
+    if (us > s->max_us)
+        s->max_us = us;
+    if (status == i2c_txn_done)
+        s->bytes += txn->wr_len + txn->rd_len;
+    else if (status == i2c_txn_nack)
+        s->nacks++;
+    else if (status == i2c_txn_timeout)
+        s->timeouts++;
+}
+
+/*
+PRE:
+- called by the backend (on the Pico, from its IRQ handler) once the active
+    transaction has finished, failed or been aborted
+PURPOSE:
+- records the outcome, gives the bus to the next queued transaction and then
+    runs the finished transaction's callback
+*/
+void i2c_engine_complete(i2c_engine_t *eng, enum i2c_txn_status_t status)
+{
+    i2c_txn_t *txn = eng->active;
+    if (txn == NULL)
+        return;
+    txn->complete_us = eng->backend->now_us(eng->ctx);
+    eng->stats.completed++;
+    eng->stats.bus_us += txn->complete_us - txn->start_us;
+    if (status == i2c_txn_done)
+        eng->stats.bytes += txn->wr_len + txn->rd_len;
+    else if (status == i2c_txn_nack)
+        eng->stats.nacks++;
+    else if (status == i2c_txn_timeout)
+        eng->stats.timeouts++;
+    i2c_engine_profile_txn(eng, txn, status);
+    eng->active = NULL;
+    if (eng->head != eng->tail)
+        i2c_engine_start(eng, eng->queue[eng->tail++ & QUEUE_MASK]);
+    // status last: once it reads done the caller may reuse txn
+    txn->status = status;
+    if (txn->callback)
+        txn->callback(txn);
+}
+
+bool i2c_engine_busy(const i2c_engine_t *eng)
+{
+    return eng->active != NULL;
+}
+
+/*
+PURPOSE:
+- makes hz the default clock, for transactions that do not ask for one, and
+    switches the bus to it now if it is idle (otherwise before the next such
+    transaction starts)
+*/
+void i2c_engine_set_hz(i2c_engine_t *eng, uint32_t hz)
+{
+    uint32_t saved = eng->backend->lock(eng->ctx);
+    eng->default_hz = hz;
+    if (eng->active == NULL)
+        i2c_engine_switch_hz(eng, hz);
+    eng->backend->unlock(eng->ctx, saved);
+}
+
+size_t i2c_engine_profile(i2c_engine_t *eng, i2c_site_stats_t *o_sites, size_t max_sites)
+{
+    uint32_t saved = eng->backend->lock(eng->ctx);
+    size_t n = eng->num_sites < max_sites ? eng->num_sites : max_sites;
+    for (size_t i = 0; i < n; i++)
+        o_sites[i] = eng->sites[i];
+    eng->backend->unlock(eng->ctx, saved);
+    return n;
+}
+
+void i2c_engine_profile_reset(i2c_engine_t *eng)
+{
+    uint32_t saved = eng->backend->lock(eng->ctx);
+    eng->num_sites = 0;
+    eng->sites_full = 0;
+    eng->profile_us = eng->backend->now_us(eng->ctx);
+    eng->backend->unlock(eng->ctx, saved);
+}
+
+/*
+PURPOSE:
+- aborts the active transaction once it has held the bus for longer than its
+    timeout_us, whoever submitted it. A transaction nobody waits for (e.g.
+    one submitted from an interrupt handler) would otherwise block
+    everything queued behind it for good
+*/
+static void i2c_engine_watchdog(i2c_engine_t *eng)
+{
+    const i2c_engine_backend_t *be = eng->backend;
+    // locked: the active transaction cannot complete and hand over the bus
+    // while its start time is checked
+    uint32_t saved = be->lock(eng->ctx);
+    i2c_txn_t *txn = eng->active;
+    if (txn != NULL && be->now_us(eng->ctx) - txn->start_us > txn->timeout_us)
+    {
+        be->abort(eng->ctx);
+        i2c_engine_complete(eng, i2c_txn_timeout);
+    }
+    be->unlock(eng->ctx, saved);
+}
+
+enum i2c_txn_status_t i2c_engine_wait(i2c_engine_t *eng, i2c_txn_t *txn)
+{
+    const i2c_engine_backend_t *be = eng->backend;
+    uint64_t start = be->now_us(eng->ctx);
+    while (!i2c_txn_finished(txn))
+    {
+        // also expires the transactions queued ahead of txn
+        i2c_engine_watchdog(eng);
+        if (i2c_txn_finished(txn))
+            break;
+        be->idle(eng->ctx);
+    }
+    eng->stats.wait_us += be->now_us(eng->ctx) - start;
+    return txn->status;
+}
+
+int i2c_engine_write_read_blocking(i2c_engine_t *eng, uint8_t addr,
+                                   const uint8_t *wr, size_t wr_len,
+                                   uint8_t *rd, size_t rd_len)
+{
+    return i2c_engine_write_read_timed(eng, addr, wr, wr_len, rd, rd_len, NULL);
+}
+
+int i2c_engine_transfer(i2c_engine_t *eng, i2c_txn_t *txn)
+{
+    if (!i2c_engine_submit(eng, txn))
+        return I2C_ENGINE_ERR_NACK;
+    switch (i2c_engine_wait(eng, txn))
+    {
+    case i2c_txn_done:
+        return (int)(txn->rd_len ? txn->rd_len : txn->wr_len);
+    case i2c_txn_timeout:
+        return I2C_ENGINE_ERR_TIMEOUT;
+    default:
+        return I2C_ENGINE_ERR_NACK;
+    }
+}
+
+int i2c_engine_write_read_timed(i2c_engine_t *eng, uint8_t addr,
+                                const uint8_t *wr, size_t wr_len,
+                                uint8_t *rd, size_t rd_len,
+                                uint64_t *o_complete_us)
+{
+    i2c_txn_t txn = {
+        .addr = addr,
+        .wr = wr,
+        .wr_len = (uint16_t)wr_len,
+        .rd = rd,
+        .rd_len = (uint16_t)rd_len};
+    int ret = i2c_engine_transfer(eng, &txn);
+    if (o_complete_us)
+        *o_complete_us = txn.complete_us;
+    return ret;
+}
+
+int i2c_engine_write_blocking(i2c_engine_t *eng, uint8_t addr,
+                              const uint8_t *src, size_t len)
+{
+    return i2c_engine_write_read_blocking(eng, addr, src, len, NULL, 0);
+}
+
+int i2c_engine_read_blocking(i2c_engine_t *eng, uint8_t addr,
+                             uint8_t *dst, size_t len)
+{
+    return i2c_engine_write_read_blocking(eng, addr, NULL, 0, dst, len);
+}
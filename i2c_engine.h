@@ -0,0 +1,205 @@
+/*
+QUEUED I2C TRANSACTION ENGINE
+- a driver describes a transfer as an i2c_txn_t (write phase, optional
+    repeated-start read phase) and submits it; the engine runs submitted
+    transactions one after another on its bus
+- the bytes are moved by a backend: i2c_engine_pico.c drives the RP2350 I2C
+    block with two DMA channels and completes transactions from the I2C IRQ,
+    tools/ provides a simulated bus for host benchmarks
+- completion is reported through txn->status (poll i2c_txn_finished) and an
+    optional callback, which runs in interrupt context on the Pico
+- the blocking helpers (i2c_engine_write_read_blocking, ...) submit and wait,
+    so drivers that still need the result immediately share the same queue
+    as asynchronous users instead of fighting them for the bus
+- a transaction may ask for its own SCL clock (txn->hz); the engine switches
+    the bus to it before the transaction starts and back to the default
+    clock for transactions that do not ask. Runs of transactions at the same
+    clock cost no switch
+- every finished transaction is also counted per (address, call site) in
+    eng->sites: transactions, bytes, NACKs, timeouts and bus time. The call
+    site is the transaction's own (txn->site) or else the innermost
+    I2C_SITE in force when it was submitted, so the time spent polling
+    inside bmp581_wait_for_drdy shows apart from the reads of the sample
+This file is plain C with no Pico SDK dependency.
+*/
+#ifndef I2C_ENGINE_H
+#define I2C_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_ENGINE_QUEUE_LEN 16 // power of two
+#define I2C_ENGINE_MAX_XFER 256 // longest write + read in one transaction
+#define I2C_ENGINE_DEFAULT_TIMEOUT_US 10000
+#define I2C_ENGINE_PROFILE_SITES 32 // (address, call site) pairs counted apart
+
+// same values as PICO_ERROR_GENERIC and PICO_ERROR_TIMEOUT, so the blocking
+// helpers are drop-in replacements for i2c_*_blocking
+#define I2C_ENGINE_ERR_NACK -1
+#define I2C_ENGINE_ERR_TIMEOUT -2
+
+enum i2c_txn_status_t
+{
+    i2c_txn_idle,
+    i2c_txn_queued,
+    i2c_txn_busy,
+    i2c_txn_done,
+    i2c_txn_nack, // address or data not acknowledged, or arbitration lost
+    i2c_txn_timeout
+};
+
+typedef struct i2c_txn i2c_txn_t;
+typedef void (*i2c_txn_callback_t)(i2c_txn_t *txn);
+
+struct i2c_txn
+{
+    uint8_t addr;
+    const uint8_t *wr; // sent first; may be NULL if wr_len == 0
+    uint16_t wr_len;
+    uint8_t *rd; // filled after a repeated start; may be NULL if rd_len == 0
+    uint16_t rd_len;
+    uint32_t timeout_us; // 0 selects I2C_ENGINE_DEFAULT_TIMEOUT_US
+    uint32_t hz;         // SCL clock; 0 selects the default (i2c_engine_set_hz)
+    // call site for the profile; NULL takes the current I2C_SITE when the
+    // transaction is submitted, and a reused transaction keeps that one
+    const char *site;
+    i2c_txn_callback_t callback;
+    void *user;
+    // written by the engine
+    volatile enum i2c_txn_status_t status;
+    uint64_t start_us;    // when the transaction got the bus
+    uint64_t complete_us; // when it finished
+};
+
+typedef struct
+{
+    // begins txn on the bus; the backend must later call i2c_engine_complete
+    // exactly once (it may do so before returning)
+    void (*start)(void *ctx, i2c_txn_t *txn);
+    // stops the transaction in flight; called once it has timed out, from
+    // whichever caller is waiting on the engine at the time
+    void (*abort)(void *ctx);
+    // keep i2c_engine_complete from running while the queue is modified
+    uint32_t (*lock)(void *ctx);
+    void (*unlock)(void *ctx, uint32_t saved);
+    uint64_t (*now_us)(void *ctx);
+    // called in a loop while a caller waits for a transaction
+    void (*idle)(void *ctx);
+    // sets the SCL clock; only called while the bus is idle. May be NULL
+    // for a backend with a fixed clock
+    void (*set_hz)(void *ctx, uint32_t hz);
+} i2c_engine_backend_t;
+
+typedef struct
+{
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t queue_full; // submissions rejected because the queue was full
+    uint64_t bytes;      // bytes written plus bytes read
+    uint64_t bus_us;     // time transactions held the bus
+    uint64_t wait_us;    // time callers spent blocked in i2c_engine_wait
+    uint32_t hz_switches; // SCL clock changes between transactions
+} i2c_engine_stats_t;
+
+// transactions of one call site to one address
+typedef struct
+{
+    uint8_t addr;
+    const char *site; // NULL: submitted outside any I2C_SITE
+    uint32_t txns;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint64_t bytes;  // of the transactions that completed
+    uint64_t bus_us;
+    uint32_t max_us; // longest transaction
+} i2c_site_stats_t;
+
+typedef struct
+{
+    const i2c_engine_backend_t *backend;
+    void *ctx;
+    i2c_txn_t *queue[I2C_ENGINE_QUEUE_LEN];
+    uint8_t head;
+    uint8_t tail;
+    i2c_txn_t *volatile active;
+    uint32_t hz;         // SCL clock the bus is at, 0 until known
+    uint32_t default_hz; // for transactions with hz 0; 0 leaves the clock alone
+    i2c_engine_stats_t stats;
+    i2c_site_stats_t sites[I2C_ENGINE_PROFILE_SITES];
+    uint8_t num_sites;
+    uint32_t sites_full;     // transactions not profiled because sites was full
+    uint64_t profile_us;     // when the profile was last reset
+} i2c_engine_t;
+
+void i2c_engine_init(i2c_engine_t *eng, const i2c_engine_backend_t *backend,
+                     void *ctx);
+bool i2c_engine_submit(i2c_engine_t *eng, i2c_txn_t *txn);
+enum i2c_txn_status_t i2c_engine_wait(i2c_engine_t *eng, i2c_txn_t *txn);
+bool i2c_engine_busy(const i2c_engine_t *eng);
+void i2c_engine_set_hz(i2c_engine_t *eng, uint32_t hz);
+// consistent copy of up to max_sites entries of eng->sites; returns how many
+size_t i2c_engine_profile(i2c_engine_t *eng, i2c_site_stats_t *o_sites, size_t max_sites);
+void i2c_engine_profile_reset(i2c_engine_t *eng);
+// for backends only
+void i2c_engine_complete(i2c_engine_t *eng, enum i2c_txn_status_t status);
+
+static inline bool i2c_txn_finished(const i2c_txn_t *txn)
+{
+    return txn->status >= i2c_txn_done;
+}
+
+// submit and wait; return the number of bytes read (or written, for plain
+// writes) or an I2C_ENGINE_ERR_* code
+int i2c_engine_transfer(i2c_engine_t *eng, i2c_txn_t *txn);
+int i2c_engine_write_read_blocking(i2c_engine_t *eng, uint8_t addr,
+                                   const uint8_t *wr, size_t wr_len,
+                                   uint8_t *rd, size_t rd_len);
+// as above, also returning when the transaction finished (time_us_64() on the
+// Pico), i.e. when the data was acquired
+int i2c_engine_write_read_timed(i2c_engine_t *eng, uint8_t addr,
+                                const uint8_t *wr, size_t wr_len,
+                                uint8_t *rd, size_t rd_len,
+                                uint64_t *o_complete_us);
+int i2c_engine_write_blocking(i2c_engine_t *eng, uint8_t addr,
+                              const uint8_t *src, size_t len);
+int i2c_engine_read_blocking(i2c_engine_t *eng, uint8_t addr,
+                             uint8_t *dst, size_t len);
+
+// the call site of the transactions submitted from here on; I2C_SITE sets it
+// for the rest of the enclosing block and restores the outer one on the way
+// out. Interrupt handlers name their site in the transaction instead
+extern const char *i2c_engine_site;
+
+static inline const char *i2c_site_enter(const char *site)
+{
+    const char *outer = i2c_engine_site;
+    i2c_engine_site = site;
+    return outer;
+}
+
+static inline void i2c_site_leave(const char *const *outer)
+{
+    i2c_engine_site = *outer;
+}
+
+#define I2C_SITE(NAME)                                                          \
+    const char *const i2c_site_outer __attribute__((cleanup(i2c_site_leave))) = \
+        i2c_site_enter(NAME)
+
+// Pico backend (i2c_engine_pico.c): the engine bound to an initialised I2C
+// instance, set up on first use
+struct i2c_inst;
+i2c_engine_t *i2c_engine_get(struct i2c_inst *i2c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
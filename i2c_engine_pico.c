@@ -0,0 +1,189 @@
+/*
+DMA BACKEND FOR THE I2C ENGINE
+- the whole transaction is turned into IC_DATA_CMD words up front: one word
+    per byte written, one read command per byte read (RESTART on the first
+    read, STOP on the last word), and a TX DMA channel feeds them to the I2C
+    block paced by its TX DREQ
+- an RX DMA channel paced by the RX DREQ copies received bytes straight into
+    txn->rd
+- the I2C interrupt is only unmasked while one of our transactions is on the
+    bus. STOP_DET completes the transaction, TX_ABRT (NACK, arbitration lost)
+    marks it failed. Leaving the interrupt masked otherwise matters: the SDK's
+    i2c_*_blocking calls poll and clear the same STOP_DET/TX_ABRT flags
+    themselves
+- blocking SDK calls must therefore only be made while the engine is idle;
+    the drivers go through i2c_device.h and never make them
+*/
+#include "i2c_engine.h"
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define I2C_ENGINE_IRQ_MASK \
+    (I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS)
+#define I2C_ENGINE_ABORT_SPIN_US 100
+
+typedef struct
+{
+    i2c_inst_t *i2c;
+    i2c_engine_t eng;
+    bool ready;
+    bool aborted;
+    unsigned int tx_dma;
+    unsigned int rx_dma;
+    dma_channel_config tx_cfg;
+    dma_channel_config rx_cfg;
+    uint32_t cmds[I2C_ENGINE_MAX_XFER];
+} pico_i2c_bus_t;
+
+static pico_i2c_bus_t buses[2];
+
+static void pico_i2c_start(void *ctx, i2c_txn_t *txn)
+{
+    pico_i2c_bus_t *bus = ctx;
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    size_t n = 0;
+    for (size_t k = 0; k < txn->wr_len; k++)
+        bus->cmds[n++] = txn->wr[k];
+    for (size_t k = 0; k < txn->rd_len; k++)
+        bus->cmds[n++] = I2C_IC_DATA_CMD_CMD_BITS |
+                         (k == 0 && txn->wr_len ? I2C_IC_DATA_CMD_RESTART_BITS : 0);
+    bus->cmds[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    hw->enable = 0;
+    hw->tar = txn->addr;
+    hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    (void)hw->clr_intr;
+    bus->aborted = false;
+    hw->intr_mask = I2C_ENGINE_IRQ_MASK;
+    if (txn->rd_len)
+        dma_channel_configure(bus->rx_dma, &bus->rx_cfg, txn->rd, &hw->data_cmd,
+                              txn->rd_len, true);
+    dma_channel_configure(bus->tx_dma, &bus->tx_cfg, &hw->data_cmd, bus->cmds,
+                          n, true);
+}
+
+// PRE: interrupts disabled (called by i2c_engine_wait under the engine lock)
+static void pico_i2c_abort(void *ctx)
+{
+    pico_i2c_bus_t *bus = ctx;
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    absolute_time_t until = make_timeout_time_us(I2C_ENGINE_ABORT_SPIN_US);
+    hw->intr_mask = 0;
+    dma_channel_abort(bus->tx_dma);
+    dma_channel_abort(bus->rx_dma);
+    hw->enable |= I2C_IC_ENABLE_ABORT_BITS;
+    while ((hw->enable & I2C_IC_ENABLE_ABORT_BITS) && !time_reached(until))
+        tight_loop_contents();
+    (void)hw->clr_intr;
+}
+
+static void pico_i2c_irq(pico_i2c_bus_t *bus)
+{
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    uint32_t stat = hw->intr_stat;
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+    {
+        (void)hw->clr_tx_abrt;
+        dma_channel_abort(bus->tx_dma);
+        dma_channel_abort(bus->rx_dma);
+        bus->aborted = true;
+    }
+    if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+    {
+        (void)hw->clr_stop_det;
+        hw->intr_mask = 0;
+        // the last received bytes may still be on their way out of the FIFO
+        while (!bus->aborted && dma_channel_is_busy(bus->rx_dma))
+            tight_loop_contents();
+        i2c_engine_complete(&bus->eng,
+                            bus->aborted ? i2c_txn_nack : i2c_txn_done);
+    }
+}
+
+static void pico_i2c0_irq(void) { pico_i2c_irq(&buses[0]); }
+
+static void pico_i2c1_irq(void) { pico_i2c_irq(&buses[1]); }
+
+static uint32_t pico_i2c_lock(void *ctx)
+{
+    (void)ctx;
+    return save_and_disable_interrupts();
+}
+
+static void pico_i2c_unlock(void *ctx, uint32_t saved)
+{
+    (void)ctx;
+    restore_interrupts(saved);
+}
+
+static uint64_t pico_i2c_now_us(void *ctx)
+{
+    (void)ctx;
+    return time_us_64();
+}
+
+static void pico_i2c_idle(void *ctx)
+{
+    (void)ctx;
+    tight_loop_contents();
+}
+
+// the block is disabled and re-enabled around the new SCL counts; the engine
+// only asks between transactions
+static void pico_i2c_set_hz(void *ctx, uint32_t hz)
+{
+    pico_i2c_bus_t *bus = ctx;
+    i2c_set_baudrate(bus->i2c, hz);
+}
+
+static const i2c_engine_backend_t pico_i2c_backend = {
+    .start = pico_i2c_start,
+    .abort = pico_i2c_abort,
+    .lock = pico_i2c_lock,
+    .unlock = pico_i2c_unlock,
+    .now_us = pico_i2c_now_us,
+    .idle = pico_i2c_idle,
+    .set_hz = pico_i2c_set_hz,
+};
+
+/*
+PRE:
+- i2c_init has been called for i2c
+PURPOSE:
+- returns the engine for i2c, claiming its two DMA channels and installing
+    its interrupt handler the first time it is asked for
+*/
+i2c_engine_t *i2c_engine_get(struct i2c_inst *i2c)
+{
+    unsigned int idx = i2c_get_index(i2c);
+    pico_i2c_bus_t *bus = &buses[idx];
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    if (bus->ready)
+        return &bus->eng;
+    bus->i2c = i2c;
+    bus->tx_dma = dma_claim_unused_channel(true);
+    bus->rx_dma = dma_claim_unused_channel(true);
+
+    bus->tx_cfg = dma_channel_get_default_config(bus->tx_dma);
+    channel_config_set_transfer_data_size(&bus->tx_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&bus->tx_cfg, true);
+    channel_config_set_write_increment(&bus->tx_cfg, false);
+    channel_config_set_dreq(&bus->tx_cfg, i2c_get_dreq(i2c, true));
+
+    bus->rx_cfg = dma_channel_get_default_config(bus->rx_dma);
+    channel_config_set_transfer_data_size(&bus->rx_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&bus->rx_cfg, false);
+    channel_config_set_write_increment(&bus->rx_cfg, true);
+    channel_config_set_dreq(&bus->rx_cfg, i2c_get_dreq(i2c, false));
+
+    i2c_engine_init(&bus->eng, &pico_i2c_backend, bus);
+    hw->intr_mask = 0;
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    irq_set_exclusive_handler(I2C0_IRQ + idx, idx ? pico_i2c1_irq : pico_i2c0_irq);
+    irq_set_enabled(I2C0_IRQ + idx, true);
+    bus->ready = true;
+    return &bus->eng;
+}
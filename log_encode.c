@@ -0,0 +1,90 @@
+/*
+LOG ENCODING
+- the channel table, file header and record encoding of log_format.h, kept
+    apart from the SD card code in logging.c so it also builds on a host
+*/
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "logging.h"
+#include "log_format.h"
+
+#define LOG_CHANNEL(NAME, UNIT, TYPE, FIELD, FRAC_BITS, EXP10)     \
+    {                                                              \
+        .name = NAME, .unit = UNIT, .type = TYPE,                  \
+        .offset = offsetof(struct log_record_t, FIELD),            \
+        .frac_bits = FRAC_BITS, .exp10 = EXP10                     \
+    }
+
+static const struct log_channel_t log_channels[] = {
+    LOG_CHANNEL("time", "ms", log_type_u32, time_ms, 0, 0),
+    LOG_CHANNEL("pressure", "Pa", log_type_i32, press, 6, 0),
+#if SENSORS_FIXED_POINT
+    LOG_CHANNEL("uv_index", "", log_type_i32, uv, Q16_FRAC_BITS, 0),
+#else
+    LOG_CHANNEL("uv_index", "", log_type_f32, uv, 0, 0),
+#endif
+    LOG_CHANNEL("temperature", "degC", log_type_i16, temperature, 0, -2),
+    LOG_CHANNEL("direction", "deg", log_type_i16, direction, 0, 0),
+    LOG_CHANNEL("press_temp", "degC", log_type_i16, press_temperature, 0, -2),
+    LOG_CHANNEL("dir_pitch", "deg", log_type_i16, pitch, 0, 0),
+    LOG_CHANNEL("dir_roll", "deg", log_type_i8, roll, 0, 0),
+    LOG_CHANNEL("@uv", "us", log_type_u64, uv_us, 0, 0),
+    LOG_CHANNEL("@press", "us", log_type_u64, press_us, 0, 0),
+    LOG_CHANNEL("@dir", "us", log_type_u64, direction_us, 0, 0),
+    LOG_CHANNEL("@temperature", "us", log_type_u64, temperature_us, 0, 0),
+    LOG_CHANNEL("spin_rate", "deg/s", log_type_i32, spin_rate, 0, -3),
+    LOG_CHANNEL("spin_freq", "Hz", log_type_u16, spin_freq, 0, -3),
+    LOG_CHANNEL("spin_amp", "deg", log_type_u16, spin_amp, 0, -1),
+    LOG_CHANNEL("@spin", "us", log_type_u64, spin_us, 0, 0),
+    LOG_CHANNEL("i2c_busy", "%", log_type_u16, i2c_busy, 0, -1),
+    LOG_CHANNEL("i2c_bmp581", "%", log_type_u16, i2c_bmp581, 0, -1),
+    LOG_CHANNEL("i2c_veml6075", "%", log_type_u16, i2c_veml6075, 0, -1),
+    LOG_CHANNEL("i2c_cmps12", "%", log_type_u16, i2c_cmps12, 0, -1),
+    LOG_CHANNEL("i2c_tmp117", "%", log_type_u16, i2c_tmp117, 0, -1),
+    LOG_CHANNEL("i2c_errors", "", log_type_u16, i2c_errors, 0, 0),
+};
+static_assert(sizeof log_channels / sizeof *log_channels <= LOG_MAX_CHANNELS);
+
+void logging_build_header(const log_config_t *config,
+                          struct log_file_header_t *header)
+{
+    memset(header, 0, sizeof *header);
+    memcpy(header->magic, LOG_FORMAT_MAGIC, LOG_FORMAT_MAGIC_LEN);
+    header->version = LOG_FORMAT_VERSION;
+    header->header_bytes = sizeof *header;
+    header->record_bytes = sizeof(struct log_record_t);
+    header->num_channels = sizeof log_channels / sizeof *log_channels;
+    header->bmp581_osr_t = config->bmp581_osr_config & 0x07;
+    header->bmp581_osr_p = config->bmp581_osr_config >> 3 & 0x07;
+    header->veml6075_hd = config->veml6075_hd;
+    header->veml6075_it_ms = config->veml6075_it_ms;
+    memcpy(header->channels, log_channels, sizeof log_channels);
+}
+
+void logging_encode(const log_t *log, struct log_record_t *o_record)
+{
+    *o_record = (struct log_record_t){
+        .time_ms = log->time_ms,
+        .press = log->press_data,
+        .uv = log->uv,
+        .temperature = log->temperature,
+        .direction = log->direction,
+        .press_temperature = log->press_temperature,
+        .pitch = log->pitch,
+        .roll = log->roll,
+        .uv_us = log->uv_us,
+        .press_us = log->press_us,
+        .direction_us = log->direction_us,
+        .temperature_us = log->temperature_us,
+        .spin_rate = (int32_t)log->spin_rate,
+        .spin_freq = (uint16_t)(log->spin_freq > UINT16_MAX ? UINT16_MAX : log->spin_freq),
+        .spin_amp = (uint16_t)(log->spin_amp > UINT16_MAX ? UINT16_MAX : log->spin_amp),
+        .spin_us = log->spin_us,
+        .i2c_busy = (uint16_t)log->i2c_busy,
+        .i2c_bmp581 = (uint16_t)log->i2c_bmp581,
+        .i2c_veml6075 = (uint16_t)log->i2c_veml6075,
+        .i2c_cmps12 = (uint16_t)log->i2c_cmps12,
+        .i2c_tmp117 = (uint16_t)log->i2c_tmp117,
+        .i2c_errors = (uint16_t)(log->i2c_errors > UINT16_MAX ? UINT16_MAX : log->i2c_errors)};
+}
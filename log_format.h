@@ -0,0 +1,173 @@
+/*
+BINARY LOG FORMAT
+- a log file is one log_file_header_t followed by fixed size records, back
+    to back or, when block_bytes is set, in blocks (see BLOCKS)
+- the header describes every channel of a record (name, unit, storage type,
+    byte offset and scaling), so a decoder never needs to know the firmware
+    version that wrote the file, only LOG_FORMAT_VERSION
+- header_bytes covers the channel table the writer had room for; decoders
+    accept any table up to LOG_MAX_CHANNELS, so raising it keeps older files
+    readable
+- all multi-byte fields are little-endian (native on the RP2350 and on the
+    hosts we decode on) and nothing is padded
+- a channel's physical value is raw / 2^frac_bits * 10^exp10
+    e.g. BMP581 pressure is stored exactly as read (Pa with 6 fractional
+    bits), temperature as centi-degrees
+ACQUISITION TIMESTAMPS
+- a record holds the newest value of every sensor when it was staged, and
+    the sensors run at different rates, so the record time says little about
+    when each value was measured
+- a u64 channel named "@<prefix>" with unit "us" is the time_us_64() at
+    which the readings of every channel whose name starts with <prefix>
+    were read off the bus; channels without one are taken at the record
+    time
+- tools/log_decode --align uses them to resample all channels onto a
+    common time grid
+This header is shared with the host tools in tools/, so it must stay valid C
+and C++.
+*/
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+#include "fixed_point.h"
+#ifndef __cplusplus
+#include <assert.h>
+#endif
+
+#define LOG_FORMAT_MAGIC "SLOG"
+#define LOG_FORMAT_MAGIC_LEN 4
+#define LOG_FORMAT_VERSION 2 // 2: block_bytes; version 1 files have 0 there
+#define LOG_MAX_CHANNELS 24
+#define LOG_CHANNEL_NAME_LEN 12
+#define LOG_CHANNEL_UNIT_LEN 8
+
+#define LOG_PACKED __attribute__((packed))
+
+enum log_channel_type_t
+{
+    log_type_u8 = 1,
+    log_type_i8,
+    log_type_u16,
+    log_type_i16,
+    log_type_u32,
+    log_type_i32,
+    log_type_u64,
+    log_type_i64,
+    log_type_f32
+};
+
+struct LOG_PACKED log_channel_t
+{
+    char name[LOG_CHANNEL_NAME_LEN]; // NUL padded, not necessarily terminated
+    char unit[LOG_CHANNEL_UNIT_LEN]; // NUL padded, not necessarily terminated
+    uint8_t type;                    // enum log_channel_type_t
+    uint8_t offset;                  // byte offset inside a record
+    uint8_t frac_bits;               // binary scaling, value = raw / 2^frac_bits
+    int8_t exp10;                    // decimal scaling, value *= 10^exp10
+};
+
+struct LOG_PACKED log_file_header_t
+{
+    char magic[LOG_FORMAT_MAGIC_LEN];
+    uint16_t version;
+    uint16_t header_bytes; // sizeof(struct log_file_header_t)
+    uint16_t record_bytes; // size of every record that follows
+    uint8_t num_channels;  // valid entries in channels[]
+    // acquisition settings in force when the file was opened
+    uint8_t bmp581_osr_t;      // OSR_CONFIG.osr_t code (oversampling 2^code)
+    uint8_t bmp581_osr_p;      // OSR_CONFIG.osr_p code (oversampling 2^code)
+    uint8_t veml6075_hd;       // 1 if high dynamic mode was enabled
+    uint16_t veml6075_it_ms;   // UV integration time in ms
+    uint16_t block_bytes;      // 0: records back to back, else see BLOCKS
+    uint16_t reserved;
+    struct log_channel_t channels[LOG_MAX_CHANNELS];
+};
+
+/*
+one acquisition. Adding a channel means appending a field here, describing it
+in logging.c and bumping nothing: the decoder follows the header. Changing the
+meaning of an existing field needs a LOG_FORMAT_VERSION bump.
+*/
+struct LOG_PACKED log_record_t
+{
+    uint32_t time_ms;    // ms since boot when the record was staged
+    int32_t press;       // raw BMP581 pressure, Pa, 6 fractional bits
+#if SENSORS_FIXED_POINT
+    int32_t uv;          // UV index, 16 fractional bits
+#else
+    float uv;            // UV index
+#endif
+    int16_t temperature; // TMP117, centi-degC
+    int16_t direction;   // CMPS12 bearing, degrees
+    int16_t press_temperature; // BMP581, centi-degC
+    int16_t pitch;       // CMPS12, degrees; 0 in the heading-only profile
+    int8_t roll;         // CMPS12, degrees; 0 in the heading-only profile
+    // acquisition times, us since boot (see ACQUISITION TIMESTAMPS)
+    uint64_t uv_us;
+    uint64_t press_us;
+    uint64_t direction_us;
+    uint64_t temperature_us;
+    // CMPS12 spin estimate, updated once per window (see spin.h)
+    int32_t spin_rate;   // mean rotation rate, millidegrees/s
+    uint16_t spin_freq;  // dominant twist oscillation, mHz
+    uint16_t spin_amp;   // its amplitude, tenths of a degree
+    uint64_t spin_us;    // end of the window
+    // I2C bus share since the previous record, tenths of a percent
+    uint16_t i2c_busy;
+    uint16_t i2c_bmp581;
+    uint16_t i2c_veml6075;
+    uint16_t i2c_cmps12;
+    uint16_t i2c_tmp117;
+    uint16_t i2c_errors; // NACKs and timeouts since boot, saturating
+};
+
+/*
+BLOCKS
+- the SD card logger groups the records into blocks of block_bytes, the
+    first at header_bytes rounded up to block_bytes (LOG_BLOCKS_START). A
+    block is a log_block_head_t, its records, zero padding and a
+    log_block_tail_t filling its last bytes
+- the tail is the commit marker: written last, it holds the CRC-32
+    (crc32.h) of everything before it. A block torn by a power loss or a
+    reset fails the check, so the loss is one block at most and is detected
+- seq numbers a file's blocks from 0 and file_id is drawn when the file is
+    created, so blocks an older file left in the same clusters never pass
+    for this one's. The valid blocks are a prefix of the file: after a reset
+    the logger finds its end by binary search and appends from there,
+    over the torn block if there is one
+- boot counts the resets the file has been resumed across; time_ms restarts
+    at each
+*/
+#define LOG_BLOCK_BYTES 512            // one sector
+#define LOG_BLOCK_MAGIC 0x4B4C4253u    // "SBLK"
+#define LOG_COMMIT_MAGIC 0x544D4F43u   // "COMT"
+#define LOG_BLOCKS_START(HEADER_BYTES, BLOCK_BYTES) \
+    (((HEADER_BYTES) + (BLOCK_BYTES) - 1) / (BLOCK_BYTES) * (BLOCK_BYTES))
+
+struct LOG_PACKED log_block_head_t
+{
+    uint32_t magic; // LOG_BLOCK_MAGIC
+    uint32_t file_id;
+    uint32_t seq;
+    uint16_t boot;
+    uint16_t records; // records that follow, at most LOG_BLOCK_RECORDS
+};
+
+struct LOG_PACKED log_block_tail_t
+{
+    uint32_t crc;   // crc32 of the block up to here
+    uint32_t magic; // LOG_COMMIT_MAGIC
+};
+
+#define LOG_BLOCK_RECORDS                                                 \
+    ((LOG_BLOCK_BYTES - sizeof(struct log_block_head_t) -                 \
+      sizeof(struct log_block_tail_t)) / sizeof(struct log_record_t))
+
+static_assert(sizeof(struct log_channel_t) == 24, "log_channel_t layout");
+static_assert(sizeof(struct log_file_header_t) == 20 + 24 * LOG_MAX_CHANNELS,
+              "log_file_header_t layout");
+static_assert(sizeof(struct log_record_t) == 41 + 5 * 8, "log_record_t layout");
+static_assert(LOG_BLOCK_RECORDS >= 1, "a record must fit a block");
+
+#endif
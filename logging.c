@@ -46,44 +46,660 @@
 #include "f_util.h"
 #include "ff.h"
 #include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
 #include <pico/time.h>
 #include <stdio.h>
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "pico/rand.h"
 #include "hw_config.h"
 #include "logging.h"
+#include "log_format.h"
+#include "crc32.h"
 
-const char *filename = "data_log.csv";
 static FATFS fs;
+static FIL fil;
+static bool mounted;
+static bool opened;
+static log_config_t config = LOG_CONFIG_DEFAULT;
+static log_stats_t stats;
+static absolute_time_t last_sync;
 
-void write_result(log_t *log)
+// the open file: its number, when it was opened and the identity its blocks
+// carry (see BLOCKS in log_format.h)
+static struct log_file_header_t file_header;
+static uint32_t file_number;
+static absolute_time_t file_opened;
+static char file_name[32];
+static uint32_t file_id;
+static uint16_t file_boot;
+static uint32_t block_seq; // of the block being filled
+#define BLOCKS_START LOG_BLOCKS_START(sizeof(struct log_file_header_t), LOG_BLOCK_BYTES)
+
+// the block being filled; also the scratch buffer of the recovery scan
+static uint8_t block[LOG_BLOCK_BYTES] __attribute__((aligned(4)));
+static uint32_t block_records;
+#if FF_USE_FASTSEEK
+// cluster map of the open file, so f_write finds its next cluster without
+// reading the FAT. A preallocated file is one fragment: size, length, start
+// and the terminating 0
+static DWORD file_clmt[4];
+#endif
+
+// records are staged here and leave in chunk_bytes sized, chunk aligned
+// writes so FatFs can hand whole sectors straight to the card
+static uint8_t stage[LOG_STAGE_BYTES] __attribute__((aligned(4)));
+static size_t stage_len;
+static uint32_t chunk_bytes = LOG_STAGE_BYTES;
+
+static_assert(LOG_STAGE_BYTES % LOG_SECTOR_BYTES == 0);
+// the stage only ever holds whole blocks, so every write is whole sectors
+static_assert(LOG_STAGE_BYTES % LOG_BLOCK_BYTES == 0);
+static_assert(LOG_BLOCK_BYTES % LOG_SECTOR_BYTES == 0);
+
+/*
+largest multiple of the cluster size that fits in the staging buffer, or the
+staging buffer itself if a cluster is bigger than it. Cluster sizes are powers
+of two, so either way a chunk aligned write never straddles a cluster boundary
+*/
+static uint32_t log_chunk_bytes(void)
+{
+    uint32_t cluster = (uint32_t)fs.csize * LOG_SECTOR_BYTES;
+    stats.cluster_bytes = cluster;
+    if (cluster == 0 || cluster > LOG_STAGE_BYTES)
+        return LOG_STAGE_BYTES;
+    return LOG_STAGE_BYTES / cluster * cluster;
+}
+
+static bool log_stage(const void *src, size_t len)
+{
+    const uint8_t *buf = src;
+    while (len > 0)
+    {
+        size_t n = sizeof stage - stage_len;
+        if (n == 0)
+        {
+            // a full stage always holds at least one whole chunk
+            if (!logging_flush(false))
+                return false;
+            continue;
+        }
+        if (n > len)
+            n = len;
+        memcpy(stage + stage_len, buf, n);
+        stage_len += n;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+/*
+PURPOSE:
+- creates the first numbered file not yet on the card and allocates all of
+    config.rotate_bytes to it in one contiguous run, committed to the FAT
+    before any record is written. Writes then only fill the file in place:
+    no cluster chain to extend, so every append costs the same
+- a card without that much contiguous space still gets a file, grown
+    cluster by cluster as before
+*/
+static FRESULT log_create(void)
+{
+    FILINFO info;
+    FRESULT fr;
+    do
+    {
+        file_number++;
+        snprintf(file_name, sizeof file_name, config.filename, (unsigned)file_number);
+        fr = f_stat(file_name, &info);
+    } while (fr == FR_OK);
+    if (fr != FR_NO_FILE)
+        return fr;
+    fr = f_open(&fil, file_name, FA_CREATE_NEW | FA_WRITE);
+    if (fr != FR_OK)
+        return fr;
+#if FF_USE_EXPAND
+    fr = f_expand(&fil, config.rotate_bytes, 1);
+#else
+    fr = FR_DENIED;
+#endif
+    if (fr == FR_OK)
+        fr = f_sync(&fil);
+    if (fr != FR_OK)
+    {
+        printf("f_expand(%s) error: %s (%d), growing it as it fills\n",
+               file_name, FRESULT_str(fr), fr);
+        stats.unexpanded++;
+        return FR_OK;
+    }
+#if FF_USE_FASTSEEK
+    file_clmt[0] = sizeof file_clmt / sizeof *file_clmt;
+    fil.cltbl = file_clmt;
+    if (f_lseek(&fil, CREATE_LINKMAP) != FR_OK)
+        fil.cltbl = NULL;
+#endif
+    return FR_OK;
+}
+
+// state for a file just opened, new or resumed
+static void log_file_opened(void)
+{
+    opened = true;
+    stats.files++;
+    stage_len = 0;
+    block_records = 0;
+    file_opened = get_absolute_time();
+    last_sync = file_opened;
+}
+
+static bool log_open_file(void)
+{
+    FRESULT fr = log_create();
+    if (fr != FR_OK)
+    {
+        printf("f_open(%s) error: %s (%d)\n", file_name, FRESULT_str(fr), fr);
+        return false;
+    }
+    log_file_opened();
+    file_id = get_rand_32();
+    file_boot = 0;
+    block_seq = 0;
+    // the header, zero padded to the first block
+    for (uint32_t n = 0; n < BLOCKS_START; n += sizeof block)
+    {
+        size_t len = n < sizeof file_header ? sizeof file_header - n : 0;
+        memset(block, 0, sizeof block);
+        memcpy(block, (const uint8_t *)&file_header + n, len < sizeof block ? len : sizeof block);
+        log_stage(block, sizeof block);
+    }
+    printf("Logging to %s (cluster %lu B, write chunk %lu B, %lu KB preallocated)\n",
+           file_name, (unsigned long)stats.cluster_bytes, (unsigned long)chunk_bytes,
+           (unsigned long)(f_size(&fil) / 1024));
+    return true;
+}
+
+/*
+reads block seq of the open file into block; true if it is whole and
+committed (see BLOCKS in log_format.h). o_head gets its header
+*/
+static bool log_read_block(uint32_t seq, struct log_block_head_t *o_head)
+{
+    struct log_block_tail_t tail;
+    UINT br;
+    if (f_lseek(&fil, BLOCKS_START + (FSIZE_t)seq * LOG_BLOCK_BYTES) != FR_OK ||
+        f_read(&fil, block, sizeof block, &br) != FR_OK || br != sizeof block)
+        return false;
+    memcpy(o_head, block, sizeof *o_head);
+    memcpy(&tail, block + sizeof block - sizeof tail, sizeof tail);
+    return o_head->magic == LOG_BLOCK_MAGIC && tail.magic == LOG_COMMIT_MAGIC &&
+           o_head->seq == seq && o_head->records <= LOG_BLOCK_RECORDS &&
+           crc32(0, block, sizeof block - sizeof tail) == tail.crc;
+}
+
+/*
+PURPOSE:
+- reopens the newest log file when a power loss or a reset left it open: it
+    starts with the header this boot would write and has room after its
+    last block. The committed blocks are a prefix of the file, so a binary
+    search finds the last one in log2(blocks) reads, without scanning the
+    file; appending resumes right after it, over a torn block if any
+- false, with no file open, if there is nothing to resume; file_number is
+    then the newest file's, so the next one is created after it
+*/
+static bool log_resume(void)
+{
+    struct log_file_header_t existing;
+    struct log_block_head_t head;
+    uint32_t num_blocks;
+    uint32_t lo;
+    uint32_t hi;
+    UINT br;
+    FILINFO info;
+    do
+    {
+        file_number++;
+        snprintf(file_name, sizeof file_name, config.filename, (unsigned)file_number);
+    } while (f_stat(file_name, &info) == FR_OK);
+    if (--file_number == 0)
+        return false;
+    snprintf(file_name, sizeof file_name, config.filename, (unsigned)file_number);
+    if (f_open(&fil, file_name, FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK)
+        return false;
+#if FF_USE_FASTSEEK
+    // the seeks below, and every write after them, skip the FAT
+    file_clmt[0] = sizeof file_clmt / sizeof *file_clmt;
+    fil.cltbl = file_clmt;
+    if (f_lseek(&fil, CREATE_LINKMAP) != FR_OK)
+        fil.cltbl = NULL;
+#endif
+    num_blocks = f_size(&fil) > BLOCKS_START
+                     ? (uint32_t)((f_size(&fil) - BLOCKS_START) / LOG_BLOCK_BYTES)
+                     : 0;
+    if (f_read(&fil, &existing, sizeof existing, &br) != FR_OK || br != sizeof existing ||
+        memcmp(&existing, &file_header, sizeof existing) != 0 || num_blocks == 0)
+    {
+        f_close(&fil);
+        return false;
+    }
+    if (log_read_block(0, &head))
+    {
+        // the last committed block is in [lo, hi)
+        file_id = head.file_id;
+        lo = 0;
+        hi = num_blocks;
+        while (hi - lo > 1)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (log_read_block(mid, &head) && head.file_id == file_id)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        log_read_block(lo, &head);
+        block_seq = lo + 1;
+        file_boot = head.boot + 1;
+    }
+    else
+    {
+        // the header made it to the card, no block did
+        file_id = get_rand_32();
+        block_seq = 0;
+        file_boot = 0;
+    }
+    if (block_seq >= num_blocks ||
+        f_lseek(&fil, BLOCKS_START + (FSIZE_t)block_seq * LOG_BLOCK_BYTES) != FR_OK)
+    {
+        // full, or closed and cut to length on a clean shutdown
+        f_close(&fil);
+        return false;
+    }
+    log_file_opened();
+    printf("Logging to %s, resumed after %lu blocks (reset %u)\n",
+           file_name, (unsigned long)block_seq, (unsigned)file_boot);
+    return true;
+}
+
+/*
+PURPOSE:
+- closes the block being filled: head, zero padding, then the commit tail
+    with the CRC of all of it; the block goes to the stage as a whole
+*/
+static bool log_commit_block(void)
 {
-    /*
-        NOTE: To whoever is reading this.
-        I know this is mounting and un-mounting every write.
-        This is intentional.
-        I'm sorry.
-    */
+    struct log_block_head_t head = {
+        .magic = LOG_BLOCK_MAGIC,
+        .file_id = file_id,
+        .seq = block_seq,
+        .boot = file_boot,
+        .records = (uint16_t)block_records};
+    struct log_block_tail_t tail = {.magic = LOG_COMMIT_MAGIC};
+    size_t used = sizeof head + block_records * sizeof(struct log_record_t);
+    if (block_records == 0)
+        return true;
+    memcpy(block, &head, sizeof head);
+    memset(block + used, 0, sizeof block - sizeof tail - used);
+    tail.crc = crc32(0, block, sizeof block - sizeof tail);
+    memcpy(block + sizeof block - sizeof tail, &tail, sizeof tail);
+    block_records = 0;
+    // a block that never reaches the stage keeps its seq for the next one,
+    // so the committed blocks stay a prefix of the file
+    if (!log_stage(block, sizeof block))
+        return false;
+    block_seq++;
+    stats.blocks++;
+    return true;
+}
+
+/*
+writes what is left of the open file and closes it. The preallocated space
+past the last record goes back to the card, so the file ends where its data
+does
+*/
+static bool log_close_file(void)
+{
+    bool ok = logging_flush(true);
     FRESULT fr;
+    stage_len = 0;
+#if FF_USE_FASTSEEK
+    fil.cltbl = NULL;
+#endif
+    fr = f_truncate(&fil);
+    if (fr == FR_OK)
+        fr = f_close(&fil);
+    else
+        f_close(&fil);
+    opened = false;
+    if (fr != FR_OK)
+    {
+        printf("f_close(%s) error: %s (%d)\n", file_name, FRESULT_str(fr), fr);
+        stats.errors++;
+        return false;
+    }
+    return ok;
+}
+
+// at a block boundary: the open file is full or old enough (see log_config_t)
+static bool log_rotate_due(void)
+{
+    if (block_seq == 0)
+        return false;
+    if (BLOCKS_START + (uint64_t)(block_seq + 1) * LOG_BLOCK_BYTES > config.rotate_bytes)
+        return true;
+    return config.rotate_ms != 0 &&
+           absolute_time_diff_us(file_opened, get_absolute_time()) >=
+               (int64_t)config.rotate_ms * 1000;
+}
+
+static bool log_rotate(void)
+{
+    uint64_t start = time_us_64();
+    uint32_t elapsed;
+    bool ok = log_close_file();
+    ok = log_open_file() && ok;
+    // the record that asked for the rotation goes to the new file
+    elapsed = (uint32_t)(time_us_64() - start);
+    if (elapsed > stats.rotate_us)
+        stats.rotate_us = elapsed;
+    return ok;
+}
+
+bool logging_init(const log_config_t *cfg)
+{
+    FRESULT fr;
+    if (cfg)
+        config = *cfg;
     fr = f_mount(&fs, "", 1);
-    FIL fil;
-    fr = f_open(&fil, filename, FA_OPEN_APPEND | FA_WRITE);
     if (fr != FR_OK)
     {
-        printf("f_open(%s) error: %s (%d)\n", filename, FRESULT_str(fr), fr);
+        printf("f_mount error: %s (%d)\n", FRESULT_str(fr), fr);
+        return false;
+    }
+    mounted = true;
+    logging_build_header(&config, &file_header);
+    chunk_bytes = log_chunk_bytes();
+    file_header.block_bytes = LOG_BLOCK_BYTES;
+    file_number = 0;
+    if (!log_resume() && !log_open_file())
+    {
         f_unmount("");
-        return;
+        mounted = false;
+        return false;
     }
+    return true;
+}
 
-    if (f_printf(&fil, "%d, %f, %ld, %d, %d\n", to_ms_since_boot(get_absolute_time()), log->uv, log->press_data, log->direction, log->temperature) < 0)
+static bool log_write(const uint8_t *buf, UINT len)
+{
+    UINT bw;
+    FRESULT fr = f_write(&fil, buf, len, &bw);
+    if (fr != FR_OK || bw != len)
     {
-        printf("f_printf failed\n");
+        printf("f_write error: %s (%d)\n", FRESULT_str(fr), fr);
+        stats.errors++;
+        return false;
     }
+    stats.bytes_written += bw;
+    return true;
+}
 
-    fr = f_close(&fil);
+static bool log_sync(void)
+{
+    FRESULT fr = f_sync(&fil);
+    last_sync = get_absolute_time();
+    stats.syncs++;
     if (fr != FR_OK)
     {
-        printf("f_close error: %s (%d)\n", FRESULT_str(fr), fr);
+        printf("f_sync error: %s (%d)\n", FRESULT_str(fr), fr);
+        stats.errors++;
+        return false;
+    }
+    return true;
+}
+
+static bool log_sync_due(void)
+{
+    switch (config.sync_policy)
+    {
+    case log_sync_every_flush:
+        return true;
+    case log_sync_interval:
+        return absolute_time_diff_us(last_sync, get_absolute_time()) >=
+               (int64_t)config.sync_interval_ms * 1000;
+    case log_sync_never:
+    default:
+        return false;
     }
+}
+
+/*
+writes every whole chunk sitting in the staging buffer. The first write after
+opening tops the file up to the next chunk boundary so that every following
+write starts cluster aligned. With force set, the block being filled is
+committed and everything staged is written, at the cost of one write shorter
+than a chunk; core1 does this after every batch, so a reset loses at most
+the batch core0 is filling
+*/
+bool logging_flush(bool force)
+{
+    size_t done = 0;
+    bool ok = true;
+    uint64_t start;
+    uint32_t elapsed;
+    if (!opened)
+        return false;
+    if (force)
+        ok = log_commit_block();
+    start = time_us_64();
+    while (ok)
+    {
+        size_t want = chunk_bytes - (size_t)(f_tell(&fil) % chunk_bytes);
+        if (stage_len - done < want)
+        {
+            if (!force || stage_len == done)
+                break;
+            want = stage_len - done;
+        }
+        ok = log_write(stage + done, want);
+        done += want;
+    }
+    if (done == 0)
+        return ok;
+    stage_len -= done;
+    memmove(stage, stage + done, stage_len);
+    if (ok && log_sync_due())
+        ok = log_sync();
+    elapsed = (uint32_t)(time_us_64() - start);
+    stats.flushes++;
+    stats.write_us += elapsed;
+    stats.last_flush_us = elapsed;
+    if (elapsed > stats.max_flush_us)
+        stats.max_flush_us = elapsed;
+    return ok;
+}
+
+void write_result(log_t *log)
+{
+    struct log_record_t record;
+    if (!opened)
+        return;
+    if (block_records == 0 && log_rotate_due() && !log_rotate() && !opened)
+        return;
+    logging_encode(log, &record);
+    memcpy(block + sizeof(struct log_block_head_t) + block_records * sizeof record,
+           &record, sizeof record);
+    block_records++;
+    stats.records++;
+    if (block_records == LOG_BLOCK_RECORDS)
+        log_commit_block();
+}
+
+void logging_shutdown(void)
+{
+    if (opened)
+        log_close_file();
+    if (mounted)
+    {
+        f_unmount("");
+        mounted = false;
+    }
+}
+
+const log_stats_t *logging_get_stats(void)
+{
+    return &stats;
+}
+
+// bytes per second over the time actually spent inside f_write/f_sync
+uint32_t logging_throughput_bps(void)
+{
+    if (stats.write_us == 0)
+        return 0;
+    return (uint32_t)(stats.bytes_written * 1000000ull / stats.write_us);
+}
+
+/*
+CORE0 -> CORE1 HAND-OFF
+- core0 fills one of two batches while core1 writes the other to the card
+- ownership moves through the inter-core FIFOs: core0 pushes a token (batch
+    index and record count) when a batch is full, core1 pushes the index back
+    once every record is staged. At most two batch tokens plus the shutdown
+    token are ever in flight, so neither side blocks on a full FIFO
+- if core1 still holds the other batch when the current one fills up, new
+    records are dropped (and counted) instead of stalling the sampling loop
+*/
+#define LOG_TOKEN_SHUTDOWN 0xFFFFFFFFu
+#define LOG_TOKEN(IDX, COUNT) ((uint32_t)(COUNT) << 8 | (IDX))
+#define LOG_TOKEN_IDX(T) ((T) & 0xFFu)
+#define LOG_TOKEN_COUNT(T) ((T) >> 8)
 
-    f_unmount("");
-}
\ No newline at end of file
+static_assert(LOG_BATCH_SIZE % LOG_BLOCK_RECORDS == 0,
+              "LOG_BATCH_SIZE must fill whole blocks");
+
+static log_t batches[2][LOG_BATCH_SIZE];
+// core0 only
+static uint8_t fill_idx;
+static uint32_t fill_count;
+static bool batch_free[2] = {true, true};
+static bool stalled;
+static log_queue_stats_t queue_stats;
+
+static void logging_core1_main(void)
+{
+    bool ok = logging_init(NULL);
+    multicore_fifo_push_blocking(ok);
+    while (true)
+    {
+        uint32_t token = multicore_fifo_pop_blocking();
+        if (token == LOG_TOKEN_SHUTDOWN)
+            break;
+        log_t *batch = batches[LOG_TOKEN_IDX(token)];
+        for (uint32_t k = 0; k < LOG_TOKEN_COUNT(token); k++)
+            write_result(batch + k);
+        logging_flush(true);
+        multicore_fifo_push_blocking(LOG_TOKEN_IDX(token));
+        logging_print_stats();
+    }
+    logging_shutdown();
+    multicore_fifo_push_blocking(LOG_TOKEN_SHUTDOWN);
+}
+
+bool logging_start_core1(const log_config_t *cfg)
+{
+    if (cfg)
+        config = *cfg;
+    multicore_launch_core1(logging_core1_main);
+    // core1 reports whether the card mounted before taking any batches
+    return multicore_fifo_pop_blocking() != 0;
+}
+
+// takes back every batch core1 has finished with
+static void log_reclaim(void)
+{
+    while (multicore_fifo_rvalid())
+    {
+        uint32_t token = multicore_fifo_pop_blocking();
+        if (token != LOG_TOKEN_SHUTDOWN)
+            batch_free[LOG_TOKEN_IDX(token)] = true;
+    }
+}
+
+static bool log_hand_off(void)
+{
+    uint8_t next = fill_idx ^ 1;
+    if (!batch_free[next])
+    {
+        if (!stalled)
+            queue_stats.overflows++;
+        stalled = true;
+        return false;
+    }
+    batch_free[fill_idx] = false;
+    // records must be visible to core1 before it sees the token
+    __dmb();
+    multicore_fifo_push_blocking(LOG_TOKEN(fill_idx, fill_count));
+    queue_stats.batches++;
+    fill_idx = next;
+    fill_count = 0;
+    stalled = false;
+    return true;
+}
+
+void log_submit(const log_t *log)
+{
+    queue_stats.submitted++;
+    log_reclaim();
+    if (fill_count == LOG_BATCH_SIZE && !log_hand_off())
+    {
+        queue_stats.dropped++;
+        return;
+    }
+    batches[fill_idx][fill_count++] = *log;
+    if (fill_count == LOG_BATCH_SIZE)
+        log_hand_off();
+}
+
+// hands over the partial batch, then waits for core1 to close the card
+void logging_stop_core1(void)
+{
+    uint32_t token;
+    while (fill_count > 0 && !log_hand_off())
+        batch_free[LOG_TOKEN_IDX(multicore_fifo_pop_blocking())] = true;
+    multicore_fifo_push_blocking(LOG_TOKEN_SHUTDOWN);
+    do
+        token = multicore_fifo_pop_blocking();
+    while (token != LOG_TOKEN_SHUTDOWN);
+}
+
+const log_queue_stats_t *logging_get_queue_stats(void)
+{
+    return &queue_stats;
+}
+
+void logging_print_stats(void)
+{
+    printf("Log: %lu records, %llu B in %lu flushes, %lu syncs, %lu errors\n",
+           (unsigned long)stats.records,
+           (unsigned long long)stats.bytes_written,
+           (unsigned long)stats.flushes,
+           (unsigned long)stats.syncs,
+           (unsigned long)stats.errors);
+    printf("Log: flush last %lu us, max %lu us, throughput %lu B/s\n",
+           (unsigned long)stats.last_flush_us,
+           (unsigned long)stats.max_flush_us,
+           (unsigned long)logging_throughput_bps());
+    printf("Log: %s, %lu blocks, %lu files, %lu not preallocated, rotation max %lu us\n",
+           file_name,
+           (unsigned long)stats.blocks,
+           (unsigned long)stats.files,
+           (unsigned long)stats.unexpanded,
+           (unsigned long)stats.rotate_us);
+    // written by core0; a torn read here only skews one printout
+    printf("Log: %lu submitted, %lu batches, %lu dropped, %lu overflows\n",
+           (unsigned long)queue_stats.submitted,
+           (unsigned long)queue_stats.batches,
+           (unsigned long)queue_stats.dropped,
+           (unsigned long)queue_stats.overflows);
+}
@@ -1,19 +1,139 @@
-// int setup_fs();
-// void write_log(char *msg);
-
 #ifndef LOG_H
 #define LOG_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed_point.h"
+
+// RAM staging area for committed blocks (see BLOCKS in log_format.h) waiting
+// to reach the card. Must be a multiple of the block size; writes are issued
+// in whole clusters when the cluster fits, otherwise in whole multiples of
+// this buffer, and whatever is left at the end of a batch.
+#define LOG_STAGE_BYTES (8 * 1024)
+#define LOG_SECTOR_BYTES 512
+// records core0 collects before handing them to core1 as one batch; core1
+// commits every batch to the card, so a reset loses at most this many. A
+// whole number of blocks (8 x LOG_BLOCK_RECORDS, 4 KB), so committing a batch
+// never writes a partly filled block
+#define LOG_BATCH_SIZE 48
+
 typedef struct
 {
-    float uv;
+    uint32_t time_ms; // record time, ms since boot
+    uv_index_t uv; // Q16 in the fixed-point build
     long press_data;
     int direction;   // int
     int temperature; // int
+    int press_temperature; // BMP581 die temperature, centi-degC
+    int pitch; // degrees
+    int roll;  // degrees
     // long
+    // time_us_64() when each reading's transaction completed
+    uint64_t uv_us;
+    uint64_t press_us; // press_data and press_temperature
+    uint64_t direction_us;
+    uint64_t temperature_us;
+    // spin estimate of the last completed window (see spin.h)
+    long spin_rate;         // millidegrees/s
+    unsigned int spin_freq; // mHz
+    unsigned int spin_amp;  // tenths of a degree
+    uint64_t spin_us;
+    // share of the I2C bus since the previous record, tenths of a percent:
+    // all of it, then each device's transactions
+    unsigned int i2c_busy;
+    unsigned int i2c_bmp581;
+    unsigned int i2c_veml6075;
+    unsigned int i2c_cmps12;
+    unsigned int i2c_tmp117;
+    unsigned long i2c_errors; // NACKs and timeouts since boot
 } log_t;
 
+// When the open file is committed to the card (directory entry + FAT) with
+// f_sync. Data written by f_write is on the card either way; f_sync only
+// bounds how much of it is unreachable after a power cut.
+enum log_sync_policy_t
+{
+    log_sync_never,       // only on logging_shutdown
+    log_sync_every_flush, // after every flush that wrote data
+    log_sync_interval     // at most once every sync_interval_ms
+};
+
+// Each file is preallocated contiguously to rotate_bytes and filled in
+// place, so appending never extends a cluster chain; the logger moves on to
+// the next numbered file when one is full or rotate_ms old.
+typedef struct
+{
+    const char *filename;  // printf pattern with one unsigned: the file number
+    uint32_t rotate_bytes; // file size, header included
+    uint32_t rotate_ms;    // 0: rotate on size only
+    enum log_sync_policy_t sync_policy;
+    uint32_t sync_interval_ms;
+    // acquisition settings recorded in the file header (see log_format.h)
+    uint8_t bmp581_osr_config; // OSR_CONFIG osr_t | osr_p bits
+    uint16_t veml6075_it_ms;
+    bool veml6075_hd;
+} log_config_t;
+
+#define LOG_CONFIG_DEFAULT                  \
+    {                                       \
+        .filename = "log_%04u.bin",         \
+        .rotate_bytes = 16 * 1024 * 1024,   \
+        .rotate_ms = 60 * 60 * 1000,        \
+        .sync_policy = log_sync_interval,   \
+        .sync_interval_ms = 10 * 1000,      \
+        /* set from the drivers at init */  \
+        .bmp581_osr_config = 0,             \
+        .veml6075_it_ms = 0,                \
+        .veml6075_hd = false,               \
+    }
+
+typedef struct
+{
+    uint32_t records;       // records staged
+    uint32_t blocks;        // blocks committed (see BLOCKS in log_format.h)
+    uint32_t flushes;       // flushes that issued at least one f_write
+    uint32_t syncs;         // f_sync calls
+    uint32_t errors;        // failed f_write/f_sync calls
+    uint64_t bytes_written; // bytes accepted by f_write
+    uint64_t write_us;      // total time spent in f_write/f_sync
+    uint32_t last_flush_us; // latency of the most recent flush
+    uint32_t max_flush_us;  // worst flush latency seen
+    uint32_t cluster_bytes; // cluster size of the mounted volume
+    uint32_t files;         // log files opened
+    uint32_t unexpanded;    // files that could not be preallocated
+    uint32_t rotate_us;     // worst time to close one file and open the next
+} log_stats_t;
+
+typedef struct
+{
+    uint32_t submitted; // records passed to log_submit
+    uint32_t batches;   // batches handed to core1
+    uint32_t dropped;   // records lost because core1 still held both batches
+    uint32_t overflows; // times a full batch found core1 still busy
+} log_queue_stats_t;
+
+// core1 owns the SD card: these are the only logging calls core0 makes
+bool logging_start_core1(const log_config_t *config);
+void log_submit(const log_t *log);
+void logging_stop_core1(void);
+const log_queue_stats_t *logging_get_queue_stats(void);
+
+// direct access, for whichever core owns the card
+bool logging_init(const log_config_t *config);
 void write_result(log_t *);
-void setup_fs();
+bool logging_flush(bool force);
+void logging_shutdown(void);
+
+// the on-card header and records, see log_format.h; no SD access
+// (log_encode.c)
+struct log_record_t;
+struct log_file_header_t;
+void logging_build_header(const log_config_t *config,
+                          struct log_file_header_t *o_header);
+void logging_encode(const log_t *log, struct log_record_t *o_record);
+
+const log_stats_t *logging_get_stats(void);
+uint32_t logging_throughput_bps(void);
+void logging_print_stats(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,33 +1,27 @@
-#include "tmp117.h"
-#include "tmp117_registers.h"
-#include "temperature.h"
-#include "uv.h"
-#include "compass.h"
 #include "pico/stdlib.h"
 #include "pico/printf.h"
 #include "hardware/i2c.h"
 #include <stdbool.h>
 #include <stdint.h>
-#include "bmp581.h"
 
 #include "hw_config.h"
 // #include "f_util.h"
 // #include "ff.h"
 #include "logging.h"
+#include "pipeline_bench.h"
+#include "i2c_engine.h"
+#include "scheduler.h"
+#include "sensors.h"
 
 #define SERIAL_INIT_DELAY_MS 1000       // adjust as needed to mitigate garbage characters after serial interface is started
+#define I2C_PORT i2c0
 #define I2C_SDA_PIN 4                   // set to a different SDA pin as needed
 #define I2C_SCL_PIN 5                   // set to a different SCL pin as needed
-#define TMP117_OFFSET_VALUE -25.0f      // temperature offset in degrees C set by user (try negative values for testing)
-#define TMP117_CONVERSION_DELAY_MS 1000 // Adjust the delay based on conversion cycle time and preference
-
-#define LOG_BUFFER_SIZE 50
-
-#define BMP581_OSR_P bmp581_osr_p_128x
-#define BMP581_OSR_T bmp581_osr_p_128x
-
-static int current_log_buffer_idx;
-log_t log_buffer[LOG_BUFFER_SIZE];
+#define I2C_BAUD_HZ (100 * 1000)        // until sensors_init has probed the devices
+#define I2C_MAX_HZ (1000 * 1000)        // fastest clock probed (Fm+, the RP2350's limit)
+#define I2C_CLOCK_PER_DEVICE 1          // 0: the whole bus at the slowest device's clock
+#define PIPELINE_BENCH_ITERATIONS 10000
+#define STREAM_AT_BOOT 0                // 1: binary live stream from the start ('s' over USB toggles it)
 
 // char *filename = "data_log.csv";
 
@@ -71,88 +65,34 @@ int main(void)
     // a little delay to ensure serial line stability
     sleep_ms(SERIAL_INIT_DELAY_MS);
 
-    // uncomment below to set I2C address other than 0x48 (e.g., 0x49)
-    // tmp117_set_address(0x49);
-
-    // Selects I2C instance (i2c_default is set as default in the tmp117.c)
-    // tmp117_set_instance(i2c1); // change to i2c1 as needed
+#if SENSORS_PIPELINE_BENCH
+    // CPU cost of one loop pass's processing, before any sensor is touched
+    pipeline_bench_run(PIPELINE_BENCH_ITERATIONS);
+#endif
 
     // initialize I2C (default i2c0) and initialize variable with I2C frequency
-    i2c_init(i2c_instance, 200 * 1000); // TMP117 400 kHz max.
+    i2c_init(I2C_PORT, I2C_BAUD_HZ);
 
     // configure the GPIO pins for I2C
     gpio_set_function(I2C_SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(I2C_SCL_PIN, GPIO_FUNC_I2C);
+    sensors_init(i2c_engine_get(I2C_PORT), I2C_MAX_HZ, I2C_CLOCK_PER_DEVICE);
+
+    // core1 mounts the card and keeps the log file open from here on; core0
+    // only hands it records, so sampling never waits on the SD card
     {
-        enum bmp581_err_t err;
-        err = bmp581_init(i2c_instance, BMP581_OSR_T, BMP581_OSR_P);
-        if (err != bmp581_err_ok && err != bmp581_err_drdy_timeout)
-            printf("BMP581 Init: Possibly Critial Error: %d\n", (int)err);
-        else
-            printf("BMP581 Init: Device Init Successful, with code %d\n", err);
+        log_config_t log_config = LOG_CONFIG_DEFAULT;
+        sensors_log_config(&log_config);
+        if (!logging_start_core1(&log_config))
+            printf("Logging Init: SD card unavailable, records will not be saved\n");
     }
-    init_uv_sensor();
-    // check if TMP117 is on the I2C bus at the address specified
-    check_status();
-
-    // TMP117 software reset; loads EEPROM Power On Reset values
-    soft_reset();
 
+    sensors_stream(STREAM_AT_BOOT);
+    // every sensor at its own rate from here on, see scheduler.h
+    sensors_start();
     while (1)
-    {
-        bmp581_eerr_t eerr;
-        bmp581_press_t press_data;
-        do
-        {
-            sleep_ms(TMP117_CONVERSION_DELAY_MS);
-        } while (!data_ready()); // check if the data ready flag is high
-
-        /* 1) typecast temp_result register to integer, converting from two's complement
-           2) Multiply by 100 to scale the temperature (i.e. 2 decimal places)
-           3) Shift right by 7 to account for the TMP117's 1/128 resolution (Q7 format) */
-        int temp = read_temp_raw() * 100 >> 7;
-        float uv_index = get_uv();
-        int compass_angle = read_compass();
-        eerr = bmp581_read_press_handle_por(i2c_instance, &press_data, BMP581_OSR_T,
-                                            BMP581_OSR_P);
-        if (eerr != bmp581_err_ok)
-            printf("BMP581 Read: Possibly Critical Error %d", (int)eerr);
-        // Display the temperature in degrees Celsius, formatted to show two decimal places.
-        printf("Temperature: %d.%02d °C\n", temp / 100, (temp < 0 ? -temp : temp) % 100);
-        printf("UV Index: %.9f\n", uv_index);
-        printf("Compass Angle: %d°\n", compass_angle);
-        {
-            struct bmp581_pressure_t pressure;
-            pressure = bmp581_decode_press(press_data);
-            printf("Pressure: %ld.%0" BMP581_PRESSURE_DP_STR "ld\n",
-                   pressure.nat, pressure.frac);
-        }
-        // floating point functions are also available for converting temp_result to Cesius or Fahrenheit
-        // printf("\nTemperature: %.2f °C\t%.2f °F", read_temp_celsius(), read_temp_fahrenheit());
-
-        if (current_log_buffer_idx == LOG_BUFFER_SIZE)
-        {
-            for (int k = 0; k < LOG_BUFFER_SIZE; k++)
-            {
-                log_t *stored_log = log_buffer + k;
-                printf("Writing %f %ld %d %d\n",
-                       stored_log->uv,
-                       stored_log->press_data,
-                       stored_log->direction,
-                       stored_log->temperature);
-                write_result(stored_log);
-            };
-            current_log_buffer_idx = 0;
-        }
-
-        log_t log = {
-            .direction = compass_angle,
-            .press_data = press_data,
-            .uv = uv_index,
-            .temperature = temp};
-
-        log_buffer[current_log_buffer_idx++] = log;
-    }
+        sched_run_once();
 
+    logging_stop_core1();
     return 0;
 }
@@ -0,0 +1,105 @@
+/*
+PROCESSING PIPELINE BENCHMARK
+- times everything the main loop does to one sample after the bus reads:
+    UV compensation and index, compass heading bin, pressure and BMP581
+    temperature decode, the console lines and the log record encoding
+- the sensor values are canned (varied per iteration so nothing folds), so
+    it runs without any sensor attached and measures only the CPU
+- cycles come from time_us_64() and clk_sys, which is the same on both
+    architectures. Build once for each and compare:
+    - cmake -DPICO_PLATFORM=rp2350-arm-s ...
+    - cmake -DPICO_PLATFORM=rp2350-riscv ...
+    each with SENSORS_FIXED_POINT off and on (see fixed_point.h)
+- console output is formatted into a buffer, not sent, so USB does not
+    dominate the result
+*/
+#include "pipeline_bench.h"
+#include "bmp581.h"
+#include "compass.h"
+#include "fixed_point.h"
+#include "log_format.h"
+#include "logging.h"
+#include "veml6075.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include <stdio.h>
+
+#if defined(__riscv)
+#define PIPELINE_BENCH_ARCH "riscv (hazard3)"
+#else
+#define PIPELINE_BENCH_ARCH "arm (cortex-m33)"
+#endif
+
+static volatile uint32_t pipeline_bench_sink;
+
+static void pipeline_bench_once(uint32_t i, char *line, size_t line_len)
+{
+    static VEML6075_t uv_dev; // only last_index is written
+    veml6075_snapshot_t snap = {
+        .uva = (uint16_t)(4000 + (i & 0x3FF)),
+        .uvb = (uint16_t)(3000 + (i & 0x1FF)),
+        .comp1 = (uint16_t)(400 + (i & 0x3F)),
+        .comp2 = (uint16_t)(300 + (i & 0x1F)),
+        .it = IT_100MS,
+        .hd = false};
+    bmp581_press_t press = 6553600 + (long)(i & 0xFFFF); // ~102.4 kPa
+    bmp581_temp_t press_temp = (21l << 16) + (long)(i & 0xFFFF);
+    int angle_tenths = (int)(i % 3600);
+    int temp = 2150 + (int)(i & 0xFF);
+    struct log_record_t record;
+    struct bmp581_pressure_t pressure;
+    int n;
+
+#if SENSORS_FIXED_POINT
+    uv_index_t uv_index = veml6075_snapshot_index_q16(&snap);
+    n = snprintf(line, line_len, "UVA: %ld, UVB: %ld\nUV Index: %s%lu.%0*lu\n",
+                 (long)veml6075_snapshot_uva_counts(&snap),
+                 (long)veml6075_snapshot_uvb_counts(&snap), Q16_SIGN(uv_index),
+                 q16_int(uv_index), Q16_DECIMALS, q16_frac(uv_index, Q16_DECIMALS));
+#else
+    uv_index_t uv_index = veml6075_snapshot_index(&uv_dev, &snap);
+    n = snprintf(line, line_len, "UVA: %.2f, UVB: %.2f\nUV Index: %.9f\n",
+                 veml6075_snapshot_uva(&snap), veml6075_snapshot_uvb(&snap),
+                 uv_index);
+#endif
+    (void)uv_dev;
+    pressure = bmp581_decode_press(press);
+    n += snprintf(line + n, line_len - n,
+                  "cardinal: %s\nTemperature: %d.%02d\nPressure: %ld.%0" BMP581_PRESSURE_DP_STR "ld\n",
+                  getCardinalDirection(angle_tenths / 10), temp / 100, temp % 100,
+                  pressure.nat, pressure.frac);
+
+    log_t log = {
+        .time_ms = i,
+        .direction = angle_tenths / 10,
+        .press_data = press,
+        .uv = uv_index,
+        .temperature = temp,
+        .press_temperature = bmp581_decode_temp_centi(press_temp)};
+    logging_encode(&log, &record);
+    pipeline_bench_sink += record.press_temperature + record.direction + (uint32_t)n;
+}
+
+/*
+PURPOSE:
+- runs the per-sample processing iterations times and prints the average
+    cycles per loop pass for this architecture and number representation
+*/
+void pipeline_bench_run(uint32_t iterations)
+{
+    char line[160];
+    uint32_t hz = clock_get_hz(clk_sys);
+    uint64_t start;
+    uint64_t elapsed_us;
+
+    pipeline_bench_once(0, line, sizeof line); // warm up flash cache
+    start = time_us_64();
+    for (uint32_t i = 0; i < iterations; i++)
+        pipeline_bench_once(i, line, sizeof line);
+    elapsed_us = time_us_64() - start;
+
+    printf("pipeline bench: %s, %s, %lu iterations, %lu us, %lu cycles/loop\n",
+           PIPELINE_BENCH_ARCH, SENSORS_FIXED_POINT ? "fixed-point" : "float",
+           (unsigned long)iterations, (unsigned long)elapsed_us,
+           (unsigned long)(elapsed_us * hz / 1000000u / (iterations ? iterations : 1)));
+}
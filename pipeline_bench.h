@@ -0,0 +1,12 @@
+#ifndef PIPELINE_BENCH_H
+#define PIPELINE_BENCH_H
+
+#include <stdint.h>
+
+#ifndef SENSORS_PIPELINE_BENCH
+#define SENSORS_PIPELINE_BENCH 0
+#endif
+
+void pipeline_bench_run(uint32_t iterations);
+
+#endif
@@ -0,0 +1,103 @@
+#include "scheduler.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+
+static sched_task_t *sched_tasks;
+static size_t sched_num_tasks;
+
+/*
+PRE:
+- tasks stays valid for as long as the scheduler runs
+PURPOSE:
+- sets every task's first release to now + phase and clears its stats
+*/
+void sched_start(sched_task_t *tasks, size_t num_tasks)
+{
+    uint64_t start = time_us_64();
+    sched_tasks = tasks;
+    sched_num_tasks = num_tasks;
+    for (size_t i = 0; i < num_tasks; i++)
+        tasks[i].next_release_us = start + tasks[i].phase_us;
+    sched_reset_stats();
+}
+
+static sched_task_t *sched_earliest(void)
+{
+    sched_task_t *next = NULL;
+    for (size_t i = 0; i < sched_num_tasks; i++)
+        if (next == NULL || sched_tasks[i].next_release_us < next->next_release_us)
+            next = &sched_tasks[i];
+    return next;
+}
+
+static void sched_run_task(sched_task_t *task)
+{
+    sched_task_stats_t *st = &task->stats;
+    uint64_t release = task->next_release_us;
+    uint64_t start = time_us_64();
+    uint64_t end;
+    uint32_t jitter = (uint32_t)(start - release);
+    uint32_t exec;
+
+    task->fn(task->user, release);
+    end = time_us_64();
+    exec = (uint32_t)(end - start);
+
+    st->runs++;
+    st->last_jitter_us = jitter;
+    st->sum_jitter_us += jitter;
+    if (jitter > st->max_jitter_us)
+        st->max_jitter_us = jitter;
+    st->last_exec_us = exec;
+    if (exec > st->max_exec_us)
+        st->max_exec_us = exec;
+
+    // absolute releases: the next one does not depend on when this one ran
+    task->next_release_us = release + task->period_us;
+    if (end > task->next_release_us)
+    {
+        uint64_t missed = (end - task->next_release_us) / task->period_us;
+        st->overruns++;
+        st->skipped += (uint32_t)missed;
+        task->next_release_us += missed * task->period_us;
+    }
+}
+
+/*
+PRE:
+- sched_start was called
+PURPOSE:
+- sleeps until the earliest release, then runs that task and any other task
+    that has become due meanwhile
+*/
+void sched_run_once(void)
+{
+    sched_task_t *task = sched_earliest();
+    if (task == NULL)
+        return;
+    sleep_until(from_us_since_boot(task->next_release_us));
+    while ((task = sched_earliest()) != NULL &&
+           task->next_release_us <= time_us_64())
+        sched_run_task(task);
+}
+
+void sched_reset_stats(void)
+{
+    for (size_t i = 0; i < sched_num_tasks; i++)
+        sched_tasks[i].stats = (sched_task_stats_t){0};
+}
+
+void sched_print_stats(void)
+{
+    printf("%-10s %6s %5s %5s %9s %9s %9s\n", "task", "runs", "over",
+           "skip", "jit avg", "jit max", "exec max");
+    for (size_t i = 0; i < sched_num_tasks; i++)
+    {
+        const sched_task_stats_t *st = &sched_tasks[i].stats;
+        printf("%-10s %6lu %5lu %5lu %7lluus %7luus %7luus\n",
+               sched_tasks[i].name, (unsigned long)st->runs,
+               (unsigned long)st->overruns, (unsigned long)st->skipped,
+               (unsigned long long)(st->runs ? st->sum_jitter_us / st->runs : 0),
+               (unsigned long)st->max_jitter_us, (unsigned long)st->max_exec_us);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+MULTI-RATE SCHEDULER
+- every task has its own period and phase; task k is released at
+    start + phase + n * period, computed from absolute time, so a slow run
+    never shifts the releases that follow it (no drift)
+- the scheduler sleeps until the earliest release with sleep_until, which
+    arms a hardware timer alarm and waits for it with WFE, then runs every
+    task that is due, earliest release first (ties: table order)
+- tasks run to completion in thread context, one at a time, so they may use
+    the I2C bus and printf; each task's deadline is its next release
+- if a task is so late that whole periods have passed, the missed releases
+    are counted as skipped instead of being run back to back
+*/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*sched_fn_t)(void *user, uint64_t release_us);
+
+typedef struct
+{
+    uint32_t runs;
+    uint32_t overruns;      // runs that finished after the next release
+    uint32_t skipped;       // releases dropped because a whole period was missed
+    uint32_t last_jitter_us; // start of run - release
+    uint32_t max_jitter_us;
+    uint64_t sum_jitter_us;
+    uint32_t last_exec_us;
+    uint32_t max_exec_us;
+} sched_task_stats_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t period_us;
+    uint32_t phase_us; // offset of the first release from sched_start
+    sched_fn_t fn;
+    void *user;
+    // written by the scheduler
+    uint64_t next_release_us;
+    sched_task_stats_t stats;
+} sched_task_t;
+
+#define SCHED_TASK(NAME, PERIOD_US, PHASE_US, FN, USER) \
+    {                                                   \
+        .name = NAME, .period_us = PERIOD_US,           \
+        .phase_us = PHASE_US, .fn = FN, .user = USER    \
+    }
+
+void sched_start(sched_task_t *tasks, size_t num_tasks);
+void sched_run_once(void);
+void sched_reset_stats(void);
+void sched_print_stats(void);
+
+#endif
@@ -0,0 +1,537 @@
+/*
+SENSOR TASKS
+- brings up every sensor on one I2C bus and runs them as scheduler tasks
+    (see scheduler.h), each at its own rate, collecting the newest value of
+    every channel into log records and console reports
+- nothing here knows which bus it runs on: main.c passes the Pico's i2c0
+    engine, tools/sensors_host a simulated one
+*/
+#include "sensors.h"
+#include "temperature.h"
+#include "uv.h"
+#include "compass.h"
+#include "bmp581.h"
+#include "veml6075.h"
+#include "logging.h"
+#include "log_format.h"
+#include "scheduler.h"
+#include "spin.h"
+#include "trace.h"
+#include "stream.h"
+#include "pico/stdlib.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TMP117_CONV temperature_conv_1s // conversion cycle, see temperature_cycle_ms
+#define TMP117_AVG temperature_avg_8    // power-on default
+#define TMP117_ALERT_GPIO 7             // TMP117 ALERT pin; data ready falls back to polling if unconnected
+#define BMP581_INT_GPIO 6               // BMP581 INT pin; data ready falls back to polling if unconnected
+
+#define BMP581_OSR_P bmp581_osr_p_128x
+#define BMP581_OSR_T bmp581_osr_t_1x // was bmp581_osr_p_128x, whose osr_t bits are 1x anyway
+#define BMP581_PWR_MODE bmp581_normal // one sample per pressure task period, standby in between
+#define BMP581_ODR bmp581_odr_10_hz
+
+// scheduler task periods and phases; phases keep tasks from piling onto the
+// same release
+#define SPIN_CAPTURE 0 // 1: heading only at 50 Hz for the spin estimate (see spin.h)
+#if SPIN_CAPTURE
+#define COMPASS_PERIOD_US 20000   // 50 Hz, a SPIN_WINDOW every 5.1 s
+#else
+#define COMPASS_PERIOD_US 50000   // 20 Hz, a SPIN_WINDOW every 12.8 s
+#endif
+#define COMPASS_BUS_BUDGET_US 50000 // bus time per second the compass reads may use
+#define PRESSURE_PERIOD_US 100000 // 10 Hz, matches BMP581_ODR
+#define PRESSURE_PHASE_US 10000
+#define TEMP_PERIOD_US 100000 // the ALERT interrupt reads the result; this only collects it
+#define TEMP_PHASE_US 20000
+#define UV_PERIOD_US 1000000
+#define UV_START_PHASE_US 30000
+#define UV_READ_PHASE_US (UV_START_PHASE_US + 950000) // > longest get_uv_lead_ms
+#define RECORD_PERIOD_US PRESSURE_PERIOD_US           // one log record per pressure sample
+#define RECORD_PHASE_US 40000
+#define REPORT_PERIOD_US 1000000
+#define REPORT_PHASE_US 60000
+#define REPORT_STATS_EVERY 10 // reports between scheduler statistics
+#define CONSOLE_PERIOD_US 100000
+#define CONSOLE_PHASE_US 70000
+
+// SCL clocks the devices are probed at, fastest first; every part must work
+// at the last one
+static const uint32_t I2C_PROBE_HZ[] = {1000000, 400000, 200000, 100000};
+
+static i2c_device_t bmp581_dev = I2C_DEVICE("bmp581", BMP581_I2C_SLAVE_ADDR,
+                                            BMP581_I2C_MAX_HZ, BMP581_I2C_ID_REG, 1);
+static i2c_device_t veml6075_dev = I2C_DEVICE("veml6075", VEML6075_ADDRESS,
+                                              VEML6075_MAX_HZ, REG_ID, 2);
+static i2c_device_t cmps12_dev = I2C_DEVICE("cmps12", CMPS12_ADDRESS,
+                                            CMPS12_MAX_HZ, CMPS12_ID_REG, 1);
+static i2c_device_t tmp117_dev = I2C_DEVICE("tmp117", TMP117_ADDRESS,
+                                            TMP117_MAX_HZ, TMP117_ID_REG, 2);
+static i2c_device_t *const i2c_devices[] = {&bmp581_dev, &veml6075_dev, &cmps12_dev,
+                                            &tmp117_dev};
+#define NUM_I2C_DEVICES (sizeof i2c_devices / sizeof *i2c_devices)
+
+static i2c_engine_t *sensors_bus;
+static i2c_site_stats_t i2c_profile[I2C_ENGINE_PROFILE_SITES]; // off the stack
+
+// newest value of every channel, each updated by its own task
+static struct
+{
+    int temperature;
+    uv_index_t uv_index;
+    int compass_angle;
+    int compass_pitch;
+    int compass_roll;
+    bmp581_press_t press;
+    bmp581_temp_t press_temp;
+    uint64_t press_time_us; // INT edge of the newest pressure sample, or its read when polling
+    // when each value's transaction completed
+    uint64_t temperature_us;
+    uint64_t uv_us;
+    uint64_t compass_us;
+    uint64_t press_us;
+    spin_result_t spin; // time_us is 0 until the first window completes
+} latest;
+
+static void temperature_task(void *user, uint64_t release_us)
+{
+    int16_t raw;
+    (void)user;
+    (void)release_us;
+    if (!temperature_read(&raw, &latest.temperature_us)) // keep the previous conversion
+        return;
+    /* 1) typecast temp_result register to integer, converting from two's complement
+       2) Multiply by 100 to scale the temperature (i.e. 2 decimal places)
+       3) Shift right by 7 to account for the TMP117's 1/128 resolution (Q7 format) */
+    latest.temperature = raw * 100 >> 7;
+}
+
+static void compass_task(void *user, uint64_t release_us)
+{
+    (void)user;
+    (void)release_us;
+    int angle = read_compass();
+    if (angle < 0)
+        return;
+    const compass_data_t *d = compass_latest();
+    latest.compass_angle = angle;
+    latest.compass_pitch = d->profile == compass_profile_full ? d->pitch16 : d->pitch;
+    latest.compass_roll = d->roll;
+    latest.compass_us = read_compass_time_us();
+    spin_add(d->bearing_tenths, latest.compass_us, &latest.spin);
+}
+
+static void pressure_task(void *user, uint64_t release_us)
+{
+    bmp581_eerr_t eerr;
+    bmp581_press_t press;
+    bmp581_temp_t press_temp;
+    bool edge;
+    (void)user;
+    (void)release_us;
+    edge = bmp581_drdy_pending(&latest.press_time_us);
+    eerr = bmp581_read_press_temp_handle_por(&bmp581_dev, &press, &press_temp,
+                                             BMP581_OSR_T, BMP581_OSR_P);
+    if (eerr != bmp581_err_ok)
+    {
+        TRACE_ERROR("BMP581 Read: Possibly Critical Error %d", (int)eerr);
+        return;
+    }
+    latest.press = press;
+    latest.press_temp = press_temp;
+    latest.press_us = bmp581_read_time_us();
+    // no INT edge when polling: the sample is as old as the read
+    if (!edge)
+        latest.press_time_us = latest.press_us;
+}
+
+// the UV integration is triggered UV_READ_PHASE_US - UV_START_PHASE_US ahead
+// of the read; the VEML6075 idles for the rest of the period
+static void uv_start_task(void *user, uint64_t release_us)
+{
+    (void)user;
+    (void)release_us;
+    start_uv();
+}
+
+static void uv_read_task(void *user, uint64_t release_us)
+{
+    (void)user;
+    (void)release_us;
+    latest.uv_index = get_uv();
+    latest.uv_us = get_uv_time_us();
+}
+
+// index in i2c_devices of the device at addr, NUM_I2C_DEVICES if none
+static size_t i2c_device_index(uint8_t addr)
+{
+    size_t d = 0;
+    while (d < NUM_I2C_DEVICES && i2c_devices[d]->addr != addr)
+        d++;
+    return d;
+}
+
+/*
+PURPOSE:
+- share of the bus each device's transactions took since the previous call,
+    and the bus as a whole, in tenths of a percent
+*/
+static void i2c_bus_shares(uint64_t now_us, uint16_t o_device[NUM_I2C_DEVICES],
+                           uint16_t *o_total)
+{
+    static uint64_t prev_us;
+    static uint64_t prev_total_us;
+    static uint64_t prev_device_us[NUM_I2C_DEVICES];
+    uint64_t device_us[NUM_I2C_DEVICES] = {0};
+    uint64_t total_us = sensors_bus->stats.bus_us;
+    uint64_t span_us = now_us - prev_us;
+    size_t n = i2c_engine_profile(sensors_bus, i2c_profile, I2C_ENGINE_PROFILE_SITES);
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t d = i2c_device_index(i2c_profile[i].addr);
+        if (d < NUM_I2C_DEVICES)
+            device_us[d] += i2c_profile[i].bus_us;
+    }
+    if (span_us == 0)
+        span_us = 1;
+    for (size_t d = 0; d < NUM_I2C_DEVICES; d++)
+    {
+        // a profile reset restarts the counts
+        uint64_t us = device_us[d] - (device_us[d] >= prev_device_us[d] ? prev_device_us[d] : 0);
+        o_device[d] = (uint16_t)(us * 1000 / span_us);
+        prev_device_us[d] = device_us[d];
+    }
+    *o_total = (uint16_t)((total_us - prev_total_us) * 1000 / span_us);
+    prev_total_us = total_us;
+    prev_us = now_us;
+}
+
+static void record_task(void *user, uint64_t release_us)
+{
+    uint16_t share[NUM_I2C_DEVICES];
+    uint16_t busy;
+    (void)user;
+    i2c_bus_shares(release_us, share, &busy);
+    log_t log = {
+        .time_ms = (uint32_t)(release_us / 1000),
+        .direction = latest.compass_angle,
+        .press_data = latest.press,
+        .uv = latest.uv_index,
+        .temperature = latest.temperature,
+        .press_temperature = bmp581_decode_temp_centi(latest.press_temp),
+        .pitch = latest.compass_pitch,
+        .roll = latest.compass_roll,
+        .uv_us = latest.uv_us,
+        .press_us = latest.press_us,
+        .direction_us = latest.compass_us,
+        .temperature_us = latest.temperature_us,
+        .spin_rate = latest.spin.rate_mdps,
+        .spin_freq = latest.spin.osc_mhz,
+        .spin_amp = latest.spin.osc_amp_tenths,
+        .spin_us = latest.spin.time_us,
+        .i2c_busy = busy,
+        .i2c_bmp581 = share[0],
+        .i2c_veml6075 = share[1],
+        .i2c_cmps12 = share[2],
+        .i2c_tmp117 = share[3],
+        .i2c_errors = sensors_bus->stats.nacks + sensors_bus->stats.timeouts};
+    _Static_assert(NUM_I2C_DEVICES == 4, "one log channel per device in i2c_devices");
+
+    log_submit(&log);
+    if (stream_active())
+    {
+        struct log_record_t record;
+        logging_encode(&log, &record);
+        stream_record(&record);
+    }
+}
+
+// traced, not printed: see trace.h for how the lines reach the console
+static void report_task(void *user, uint64_t release_us)
+{
+    static unsigned int reports;
+    (void)user;
+    // Display the temperature in degrees Celsius, formatted to show two decimal places.
+    TRACE_INFO("Temperature: %d.%02d °C", latest.temperature / 100,
+               abs(latest.temperature) % 100);
+#if SENSORS_FIXED_POINT
+    TRACE_INFO("UV Index: %s%lu.%0*lu", Q16_SIGN(latest.uv_index), q16_int(latest.uv_index),
+               Q16_DECIMALS, q16_frac(latest.uv_index, Q16_DECIMALS));
+#else
+    TRACE_INFO("UV Index: %.9f", latest.uv_index);
+#endif
+    print_compass();
+    TRACE_INFO("Compass Angle: %d°", latest.compass_angle);
+    if (latest.spin.time_us)
+        TRACE_INFO("Spin: %s%ld.%03ld °/s, twist %lu.%03lu Hz ±%lu.%lu°",
+                   latest.spin.rate_mdps < 0 ? "-" : "", labs(latest.spin.rate_mdps) / 1000,
+                   labs(latest.spin.rate_mdps) % 1000, latest.spin.osc_mhz / 1000,
+                   latest.spin.osc_mhz % 1000, latest.spin.osc_amp_tenths / 10,
+                   latest.spin.osc_amp_tenths % 10);
+    {
+        struct bmp581_pressure_t pressure;
+        pressure = bmp581_decode_press(latest.press);
+        if (latest.press_time_us)
+            TRACE_INFO("Pressure: %ld.%0" BMP581_PRESSURE_DP_STR "ld (sampled %ld us ago)",
+                       pressure.nat, pressure.frac, (long)(release_us - latest.press_time_us));
+        else
+            TRACE_INFO("Pressure: %ld.%0" BMP581_PRESSURE_DP_STR "ld (no sample yet)",
+                       pressure.nat, pressure.frac);
+        (void)pressure; // unused below TRACE_LEVEL_INFO
+    }
+    // floating point functions are also available for converting temp_result to Cesius or Fahrenheit
+    // printf("\nTemperature: %.2f °C\t%.2f °F", read_temp_celsius(), read_temp_fahrenheit());
+    if (++reports % REPORT_STATS_EVERY == 0)
+        sched_print_stats();
+}
+
+static void print_i2c_profile_line(const char *device, const char *site,
+                                   const i2c_site_stats_t *s, uint64_t span_us)
+{
+    uint64_t share = s->bus_us * 10000 / span_us; // hundredths of a percent
+    printf("%-9s %-30s %7lu %8llu %5lu %4lu %9llu %6lu %3lu.%02lu\n", device, site,
+           (unsigned long)s->txns, (unsigned long long)s->bytes, (unsigned long)s->nacks,
+           (unsigned long)s->timeouts, (unsigned long long)s->bus_us,
+           (unsigned long)s->max_us, (unsigned long)(share / 100),
+           (unsigned long)(share % 100));
+}
+
+/*
+PURPOSE:
+- prints the I2C profile since it was last reset: one line per device and
+    call site, busiest first within a device, then the device's total
+*/
+void sensors_print_i2c_profile(void)
+{
+    size_t n = i2c_engine_profile(sensors_bus, i2c_profile, I2C_ENGINE_PROFILE_SITES);
+    uint64_t span_us = time_us_64() - sensors_bus->profile_us;
+    uint64_t busy = 0;
+    if (span_us == 0)
+        span_us = 1;
+    // by device, then bus time; a few dozen entries at most
+    for (size_t i = 1; i < n; i++)
+        for (size_t j = i; j > 0; j--)
+        {
+            i2c_site_stats_t *a = &i2c_profile[j - 1];
+            i2c_site_stats_t *b = &i2c_profile[j];
+            size_t da = i2c_device_index(a->addr);
+            size_t db = i2c_device_index(b->addr);
+            if (da < db || (da == db && (a->addr < b->addr ||
+                                         (a->addr == b->addr && a->bus_us >= b->bus_us))))
+                break;
+            i2c_site_stats_t t = *a;
+            *a = *b;
+            *b = t;
+        }
+    for (size_t i = 0; i < n; i++)
+        busy += i2c_profile[i].bus_us;
+    busy = busy * 1000 / span_us;
+    printf("I2C profile over %lu ms: bus %lu.%lu%% busy, %lu clock switches\n",
+           (unsigned long)(span_us / 1000), (unsigned long)(busy / 10),
+           (unsigned long)(busy % 10), (unsigned long)sensors_bus->stats.hz_switches);
+    printf("%-9s %-30s %7s %8s %5s %4s %9s %6s %6s\n", "device", "site", "txns",
+           "bytes", "nack", "tmo", "bus us", "max us", "bus %");
+    for (size_t i = 0; i < n;)
+    {
+        uint8_t addr = i2c_profile[i].addr;
+        size_t d = i2c_device_index(addr);
+        char name[12];
+        i2c_site_stats_t total = {.addr = addr};
+        size_t sites = 0;
+        if (d < NUM_I2C_DEVICES)
+            snprintf(name, sizeof name, "%s", i2c_devices[d]->name);
+        else
+            snprintf(name, sizeof name, "0x%02X", addr);
+        for (; i < n && i2c_profile[i].addr == addr; i++, sites++)
+        {
+            const i2c_site_stats_t *s = &i2c_profile[i];
+            total.txns += s->txns;
+            total.bytes += s->bytes;
+            total.nacks += s->nacks;
+            total.timeouts += s->timeouts;
+            total.bus_us += s->bus_us;
+            if (s->max_us > total.max_us)
+                total.max_us = s->max_us;
+            print_i2c_profile_line(name, s->site ? s->site : "-", s, span_us);
+        }
+        if (sites > 1)
+            print_i2c_profile_line(name, "(all)", &total, span_us);
+    }
+    if (sensors_bus->sites_full)
+        printf("%lu transactions not profiled, raise I2C_ENGINE_PROFILE_SITES\n",
+               (unsigned long)sensors_bus->sites_full);
+}
+
+// the binary live stream on or off (see stream.h); traces go into it while
+// it is on
+void sensors_stream(bool on)
+{
+    if (on && !stream_active())
+    {
+        log_config_t config = LOG_CONFIG_DEFAULT;
+        struct log_file_header_t header;
+        sensors_log_config(&config);
+        logging_build_header(&config, &header);
+        stream_start(&header);
+    }
+    else if (!on && stream_active())
+    {
+        stream_stop();
+        printf("Stream stopped\n");
+    }
+}
+
+// sends the traces recorded since the last run (see trace.h); single keys
+// over USB: 'i' prints the I2C profile, 'r' restarts it, 's' starts and
+// stops the live stream
+static void console_task(void *user, uint64_t release_us)
+{
+    int c;
+    (void)user;
+    (void)release_us;
+    if (stream_active())
+        trace_flush_to(stream_trace, NULL);
+    else
+        trace_flush();
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT)
+    {
+        if (c == 'i')
+            sensors_print_i2c_profile();
+        else if (c == 'r')
+        {
+            i2c_engine_profile_reset(sensors_bus);
+            printf("I2C profile reset\n");
+        }
+        else if (c == 's')
+            sensors_stream(!stream_active());
+    }
+}
+
+static sched_task_t tasks[] = {
+    SCHED_TASK("compass", COMPASS_PERIOD_US, 0, compass_task, NULL),
+    SCHED_TASK("pressure", PRESSURE_PERIOD_US, PRESSURE_PHASE_US, pressure_task, NULL),
+    SCHED_TASK("temp", TEMP_PERIOD_US, TEMP_PHASE_US, temperature_task, NULL),
+    SCHED_TASK("uv_start", UV_PERIOD_US, UV_START_PHASE_US, uv_start_task, NULL),
+    SCHED_TASK("uv_read", UV_PERIOD_US, UV_READ_PHASE_US, uv_read_task, NULL),
+    SCHED_TASK("record", RECORD_PERIOD_US, RECORD_PHASE_US, record_task, NULL),
+    SCHED_TASK("report", REPORT_PERIOD_US, REPORT_PHASE_US, report_task, NULL),
+    SCHED_TASK("console", CONSOLE_PERIOD_US, CONSOLE_PHASE_US, console_task, NULL),
+};
+
+/*
+PURPOSE:
+- probes every device's clock, up to max_hz (see i2c_device_probe_hz)
+- per_device_clock: each device's transactions run at its own clock and the
+    engine switches between them; otherwise the whole bus runs at the
+    slowest device's clock and never switches
+*/
+static void sensors_probe_clocks(i2c_engine_t *bus, uint32_t max_hz, bool per_device_clock)
+{
+    const size_t num_rates = sizeof I2C_PROBE_HZ / sizeof *I2C_PROBE_HZ;
+    size_t first = 0;
+    uint32_t slowest = 0;
+    while (first + 1 < num_rates && I2C_PROBE_HZ[first] > max_hz)
+        first++;
+    i2c_engine_set_hz(bus, I2C_PROBE_HZ[num_rates - 1]);
+    for (size_t i = 0; i < sizeof i2c_devices / sizeof *i2c_devices; i++)
+    {
+        i2c_device_t *dev = i2c_devices[i];
+        uint32_t hz;
+        dev->bus = bus;
+        dev->hz = 0;
+        hz = i2c_device_probe_hz(dev, I2C_PROBE_HZ + first, num_rates - first);
+        if (hz == 0)
+        {
+            printf("I2C: %s not answering at 0x%02X\n", dev->name, dev->addr);
+            continue;
+        }
+        printf("I2C: %s at %lu kHz\n", dev->name, (unsigned long)hz / 1000);
+        if (slowest == 0 || hz < slowest)
+            slowest = hz;
+    }
+    if (per_device_clock || slowest == 0)
+        return;
+    for (size_t i = 0; i < sizeof i2c_devices / sizeof *i2c_devices; i++)
+        i2c_devices[i]->hz = 0;
+    i2c_engine_set_hz(bus, slowest);
+    printf("I2C: whole bus at %lu kHz\n", (unsigned long)slowest / 1000);
+}
+
+/*
+PRE:
+- bus is an I2C engine whose clock can be set from I2C_PROBE_HZ up to max_hz
+PURPOSE:
+- probes the clocks (see sensors_probe_clocks), then initialises every
+    sensor on bus; failures are reported on the console and the sensor
+    keeps its fallback (polling, power-on settings, ...)
+*/
+void sensors_init(i2c_engine_t *bus, uint32_t max_hz, bool per_device_clock)
+{
+    I2C_SITE("sensors_init");
+    sensors_bus = bus;
+    sensors_probe_clocks(bus, max_hz, per_device_clock);
+    {
+        enum bmp581_err_t err;
+        err = bmp581_init(&bmp581_dev, BMP581_OSR_T, BMP581_OSR_P,
+                          BMP581_PWR_MODE, BMP581_ODR);
+        if (err == bmp581_err_odr_too_fast_for_osr)
+            printf("BMP581 Init: ODR too fast for the oversampling, the device lowered it\n");
+        else if (err != bmp581_err_ok && err != bmp581_err_drdy_timeout)
+            printf("BMP581 Init: Possibly Critial Error: %d\n", (int)err);
+        else
+            printf("BMP581 Init: Device Init Successful, with code %d\n", err);
+        err = bmp581_enable_drdy_irq(&bmp581_dev, BMP581_INT_GPIO);
+        if (err != bmp581_err_ok)
+            printf("BMP581 INT: no data ready interrupt on GPIO %d (%d), polling instead\n",
+                   BMP581_INT_GPIO, (int)err);
+    }
+    init_uv_sensor(&veml6075_dev);
+    compass_init(&cmps12_dev);
+#if SPIN_CAPTURE
+    compass_set_profile(compass_profile_heading);
+#else
+    // the most compass data the bus budget allows at the compass rate
+    compass_set_profile(compass_profile_for_budget(
+        cmps12_dev.hz ? cmps12_dev.hz : bus->hz, COMPASS_PERIOD_US, COMPASS_BUS_BUDGET_US));
+#endif
+    // check if TMP117 is on the I2C bus at the address specified
+    check_status(&tmp117_dev);
+
+    // TMP117 software reset; loads EEPROM Power On Reset values
+    temperature_soft_reset();
+    if (temperature_configure(TMP117_CONV, TMP117_AVG) != 0)
+        printf("TMP117 Config: could not set the conversion cycle, using power-on values\n");
+    if (!temperature_enable_alert_irq(TMP117_ALERT_GPIO))
+        printf("TMP117 ALERT: no data ready interrupt on GPIO %d, polling instead\n",
+               TMP117_ALERT_GPIO);
+}
+
+// acquisition settings for the log file header
+void sensors_log_config(log_config_t *log_config)
+{
+    enum bmp581_osr_t_t osr_t = BMP581_OSR_T;
+    enum bmp581_osr_p_t osr_p = BMP581_OSR_P;
+    bool odr_is_valid;
+    // in normal mode the device may have lowered the oversampling to fit
+    // the ODR; the log header gets what it really uses
+    bmp581_read_osr_eff(&bmp581_dev, &osr_t, &osr_p, &odr_is_valid);
+    log_config->bmp581_osr_config = osr_t | osr_p;
+    get_uv_settings(&log_config->veml6075_it_ms, &log_config->veml6075_hd);
+}
+
+// the task table sensors_start hands to the scheduler, for tools that
+// instrument it
+sched_task_t *sensors_tasks(size_t *o_num_tasks)
+{
+    *o_num_tasks = sizeof tasks / sizeof *tasks;
+    return tasks;
+}
+
+// every sensor at its own rate from here on, see scheduler.h
+void sensors_start(void)
+{
+    sched_start(tasks, sizeof tasks / sizeof *tasks);
+}
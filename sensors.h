@@ -0,0 +1,32 @@
+/*
+SENSOR TASKS
+- sensors_init finds the fastest clock each of the BMP581, VEML6075, CMPS12
+    and TMP117 works at on one I2C engine and brings them up; sensors_start
+    hands their tasks to the scheduler, after which the caller only runs
+    sched_run_once
+- every record logs each device's share of the bus; the full I2C profile
+    (per device and call site, see i2c_engine.h) is printed on demand:
+    'i' over USB, or sensors_print_i2c_profile
+- 's' over USB, or sensors_stream, also sends every record live as a binary
+    packet (see stream.h) for tools/stream_recv
+- plain C on top of i2c_device.h: the firmware passes the Pico's i2c0
+    engine, tools/sensors_host a simulated bus
+*/
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include "i2c_engine.h"
+#include "logging.h"
+#include "scheduler.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+void sensors_init(i2c_engine_t *bus, uint32_t max_hz, bool per_device_clock);
+void sensors_log_config(log_config_t *log_config);
+void sensors_start(void);
+sched_task_t *sensors_tasks(size_t *o_num_tasks);
+void sensors_print_i2c_profile(void);
+void sensors_stream(bool on);
+
+#endif
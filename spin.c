@@ -0,0 +1,170 @@
+#include "spin.h"
+#include <stddef.h>
+
+#define SPIN_HALF_TURN 1800 // tenths of a degree
+#define SPIN_TURN 3600
+#define Q15_ONE 32768
+
+_Static_assert((SPIN_WINDOW & (SPIN_WINDOW - 1)) == 0, "SPIN_WINDOW must be a power of two");
+
+// sin(2 pi i / 256) in Q15 for the first quarter turn
+static const int16_t SIN_Q15[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+static int32_t spin_heading[SPIN_WINDOW]; // unwrapped, tenths, from the window's first sample
+static size_t spin_count;
+static int spin_prev;
+static uint64_t spin_first_us;
+static int32_t spin_resid[SPIN_WINDOW]; // off the stack, it is small on the Pico
+
+// cos(2 pi k / SPIN_WINDOW) in Q15
+static int32_t spin_cos_q15(uint32_t k)
+{
+    uint32_t i = (k * (256 / SPIN_WINDOW) + 64) & 255; // sin(x + quarter turn)
+    if (i <= 64)
+        return SIN_Q15[i];
+    if (i <= 128)
+        return SIN_Q15[128 - i];
+    if (i <= 192)
+        return -SIN_Q15[i - 128];
+    return -SIN_Q15[256 - i];
+}
+
+static uint64_t spin_isqrt(uint64_t v)
+{
+    uint64_t r = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > v)
+        bit >>= 2;
+    while (bit)
+    {
+        if (v >= r + bit)
+        {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+            r >>= 1;
+        bit >>= 2;
+    }
+    return r;
+}
+
+/*
+PRE:
+- spin_heading holds a full window covering duration_us
+PURPOSE:
+- fits a line to the window for the mean rate, then finds the strongest
+    oscillation left in the residual
+*/
+static void spin_estimate(uint64_t duration_us, spin_result_t *o)
+{
+    const int64_t n = SPIN_WINDOW;
+    int64_t sum = 0;
+    int64_t sxy = 0;
+    int64_t sxx = 0;
+    int64_t mean;
+    int32_t *resid = spin_resid;
+    uint64_t best_power = 0;
+    uint32_t best_k = 0;
+
+    if (duration_us == 0)
+        duration_us = 1;
+    // m = 2i - (n - 1) centres the sample index and keeps it integer
+    for (int64_t i = 0; i < n; i++)
+    {
+        int64_t m = 2 * i - (n - 1);
+        sum += spin_heading[i];
+        sxy += m * spin_heading[i];
+        sxx += m * m;
+    }
+    mean = sum / n;
+
+    // slope per sample is 2 sxy / sxx tenths; samples per second come from
+    // the timestamps, as Q8 hundredths of a Hz
+    {
+        int64_t slope_q16 = (2 * sxy * 65536) / sxx;
+        int64_t rate_q8 = (int64_t)(((uint64_t)(n - 1) * 100000000u << 8) / duration_us);
+        o->rate_mdps = (int32_t)(slope_q16 * rate_q8 >> 24);
+    }
+
+    // residual after the trend, Hann windowed
+    for (int64_t i = 0; i < n; i++)
+    {
+        int64_t m = 2 * i - (n - 1);
+        int64_t r = spin_heading[i] - mean - sxy * m / sxx;
+        int32_t hann_q15 = (Q15_ONE - spin_cos_q15((uint32_t)i)) >> 1;
+        resid[i] = (int32_t)(r * hann_q15 >> 15);
+    }
+
+    // Goertzel for every bin but DC and Nyquist
+    for (uint32_t k = 1; k < SPIN_WINDOW / 2; k++)
+    {
+        int64_t coeff_q15 = 2 * (int64_t)spin_cos_q15(k);
+        int64_t s1 = 0;
+        int64_t s2 = 0;
+        int64_t power;
+        for (size_t i = 0; i < SPIN_WINDOW; i++)
+        {
+            int64_t s = resid[i] + (coeff_q15 * s1 >> 15) - s2;
+            s2 = s1;
+            s1 = s;
+        }
+        power = s1 * s1 + s2 * s2 - (coeff_q15 * s1 >> 15) * s2;
+        if (power > 0 && (uint64_t)power > best_power)
+        {
+            best_power = (uint64_t)power;
+            best_k = k;
+        }
+    }
+
+    // bin k is k / n cycles per sample; a Hann window halves the amplitude
+    o->osc_mhz = (uint32_t)((uint64_t)best_k * (n - 1) * 1000000000u /
+                            ((uint64_t)n * duration_us));
+    o->osc_amp_tenths = (uint32_t)(4 * spin_isqrt(best_power) / n);
+}
+
+void spin_reset(void)
+{
+    spin_count = 0;
+}
+
+/*
+PURPOSE:
+- adds one compass bearing (0-3599 tenths) read at time_us
+- returns true, with the estimate in o_result, when it completes a window;
+    the next window starts with the following sample
+*/
+bool spin_add(int bearing_tenths, uint64_t time_us, spin_result_t *o_result)
+{
+    if (spin_count == 0)
+    {
+        spin_heading[0] = 0;
+        spin_first_us = time_us;
+    }
+    else
+    {
+        int delta = bearing_tenths - spin_prev;
+        if (delta > SPIN_HALF_TURN)
+            delta -= SPIN_TURN;
+        else if (delta < -SPIN_HALF_TURN)
+            delta += SPIN_TURN;
+        spin_heading[spin_count] = spin_heading[spin_count - 1] + delta;
+    }
+    spin_prev = bearing_tenths;
+    if (++spin_count < SPIN_WINDOW)
+        return false;
+    spin_estimate(time_us - spin_first_us, o_result);
+    o_result->time_us = time_us;
+    spin_count = 0;
+    return true;
+}
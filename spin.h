@@ -0,0 +1,38 @@
+/*
+SPIN-RATE ESTIMATION
+- the compass bearing is fed in at the compass rate and unwrapped: a step of
+    more than 180 degrees between samples is taken as a crossing of 0/360,
+    so the payload may spin up to half a turn per sample (10 turns/s at
+    20 Hz) before it aliases
+- every SPIN_WINDOW samples the window is reduced to a few numbers:
+    - rate: the least-squares slope of the unwrapped heading, i.e. the mean
+        rotation rate over the window
+    - oscillation: the largest Goertzel bin of the detrended, Hann-windowed
+        heading, i.e. the dominant back-and-forth twist about that rate, as a
+        frequency and an amplitude
+- all integer (Q15 twiddles, 64-bit accumulators), so it costs the same on
+    both RP2350 architectures
+- samples are assumed evenly spaced; the window's first and last timestamps
+    give the real sample rate. A missed compass read shortens the time a
+    window covers but is otherwise ignored
+*/
+#ifndef SPIN_H
+#define SPIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPIN_WINDOW 256 // samples per estimate, power of two
+
+typedef struct
+{
+    int32_t rate_mdps;       // mean rotation rate, millidegrees/s, + clockwise
+    uint32_t osc_mhz;        // dominant oscillation about the mean rate, mHz
+    uint32_t osc_amp_tenths; // its amplitude, tenths of a degree
+    uint64_t time_us;        // time of the window's last sample
+} spin_result_t;
+
+void spin_reset(void);
+bool spin_add(int bearing_tenths, uint64_t time_us, spin_result_t *o_result);
+
+#endif
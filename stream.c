@@ -0,0 +1,114 @@
+#include "stream.h"
+#include "crc32.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+_Static_assert(sizeof(struct log_record_t) <= sizeof(struct log_file_header_t),
+               "STREAM_MAX_PACKET must fit a record");
+_Static_assert((TRACE_HEADER_WORDS + TRACE_MAX_ARGS) * 4 <= sizeof(struct log_file_header_t),
+               "STREAM_MAX_PACKET must fit a trace");
+
+static stream_write_t stream_write;
+static void *stream_write_user;
+static bool streaming;
+static uint16_t stream_seq;
+static uint32_t records_since_header;
+static struct log_file_header_t stream_header;
+static stream_stats_t stream_stats;
+
+static void stream_console_write(void *user, const uint8_t *buf, size_t len)
+{
+    (void)user;
+    for (size_t i = 0; i < len; i++)
+        putchar_raw(buf[i]);
+}
+
+// where the frames go; NULL selects the console
+void stream_set_output(stream_write_t write, void *user)
+{
+    stream_write = write;
+    stream_write_user = user;
+}
+
+/*
+PRE:
+- len <= STREAM_MAX_PACKET - sizeof(struct stream_packet_head_t) - STREAM_CRC_BYTES
+PURPOSE:
+- puts the next sequence number and the CRC around payload and writes the
+    COBS encoded packet between two zero bytes
+*/
+static void stream_send(enum stream_packet_type_t type, const void *payload, size_t len)
+{
+    static uint8_t packet[STREAM_MAX_PACKET];
+    static uint8_t frame[STREAM_MAX_FRAME];
+    struct stream_packet_head_t head = {.type = (uint8_t)type, .seq = stream_seq++};
+    size_t n = 0;
+    uint32_t crc;
+    size_t framed;
+    memcpy(packet, &head, sizeof head);
+    n += sizeof head;
+    memcpy(packet + n, payload, len);
+    n += len;
+    crc = crc32(0, packet, n);
+    for (int i = 0; i < STREAM_CRC_BYTES; i++)
+        packet[n++] = (uint8_t)(crc >> 8 * i);
+    // the leading zero ends whatever the receiver was in the middle of
+    frame[0] = 0;
+    framed = 1 + cobs_encode(packet, n, frame + 1);
+    frame[framed++] = 0;
+    (stream_write ? stream_write : stream_console_write)(stream_write_user, frame, framed);
+    stream_stats.packets++;
+    stream_stats.bytes += framed;
+}
+
+// streams from here on, starting with header; see stream.h
+void stream_start(const struct log_file_header_t *header)
+{
+    stream_header = *header;
+    streaming = true;
+    records_since_header = 0;
+    stream_send(stream_packet_header, &stream_header, sizeof stream_header);
+}
+
+void stream_stop(void)
+{
+    streaming = false;
+}
+
+bool stream_active(void)
+{
+    return streaming;
+}
+
+void stream_record(const struct log_record_t *record)
+{
+    if (!streaming)
+        return;
+    if (++records_since_header > STREAM_HEADER_EVERY)
+    {
+        stream_send(stream_packet_header, &stream_header, sizeof stream_header);
+        records_since_header = 1;
+    }
+    stream_send(stream_packet_record, record, sizeof *record);
+}
+
+// the trace as 32-bit little-endian words, whatever the width of trace_word_t
+void stream_trace(void *user, const trace_word_t *rec, size_t nwords)
+{
+    uint8_t words[(TRACE_HEADER_WORDS + TRACE_MAX_ARGS) * 4];
+    (void)user;
+    if (!streaming)
+        return;
+    for (size_t i = 0; i < nwords; i++)
+    {
+        uint32_t w = (uint32_t)rec[i];
+        for (int k = 0; k < 4; k++)
+            words[4 * i + k] = (uint8_t)(w >> 8 * k);
+    }
+    stream_send(stream_packet_trace, words, nwords * 4);
+}
+
+const stream_stats_t *stream_get_stats(void)
+{
+    return &stream_stats;
+}
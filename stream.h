@@ -0,0 +1,75 @@
+/*
+LIVE SAMPLE STREAM
+- while streaming is on, every log record also goes out over the USB
+    console as a binary packet, for live monitoring without the SD card
+    (tools/stream_recv receives it)
+- a packet is a stream_packet_head_t (type, sequence number), the payload
+    and the CRC-32 (crc32.h) of both, little-endian. It is COBS encoded
+    (cobs.h) and framed by a zero byte on either side, so console text or
+    a corrupt packet between two packets only costs itself
+- payloads are the log file's own structures (log_format.h): the file
+    header when streaming starts and every STREAM_HEADER_EVERY records, so
+    a receiver that joins late can decode, then the records as encoded for
+    the file. Traces (trace.h) travel as packets too while streaming
+- the sequence number counts every packet, so a receiver sees how many it
+    missed
+tools/stream_recv reads stream_packet_head_t straight off the decoded frame,
+so it is LOG_PACKED like the log structures and holds fixed-width fields only.
+*/
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cobs.h"
+#include "log_format.h"
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_HEADER_EVERY 100 // records between repeated file headers
+
+enum stream_packet_type_t
+{
+    stream_packet_header = 1, // struct log_file_header_t
+    stream_packet_record = 2, // struct log_record_t
+    stream_packet_trace = 3   // one trace (trace.h), 32-bit words
+};
+
+struct LOG_PACKED stream_packet_head_t
+{
+    uint8_t type; // enum stream_packet_type_t
+    uint16_t seq;
+};
+
+#define STREAM_CRC_BYTES 4
+#define STREAM_MAX_PACKET \
+    (sizeof(struct stream_packet_head_t) + sizeof(struct log_file_header_t) + STREAM_CRC_BYTES)
+#define STREAM_MAX_FRAME (COBS_MAX_ENCODED(STREAM_MAX_PACKET) + 2)
+
+typedef struct
+{
+    uint32_t packets;
+    uint32_t bytes; // on the wire, framing included
+} stream_stats_t;
+
+// where the frames go; the default writes them to the console
+typedef void (*stream_write_t)(void *user, const uint8_t *buf, size_t len);
+
+void stream_set_output(stream_write_t write, void *user);
+void stream_start(const struct log_file_header_t *header);
+void stream_stop(void);
+bool stream_active(void);
+void stream_record(const struct log_record_t *record);
+// a trace_sink_t for trace_flush_to
+void stream_trace(void *user, const trace_word_t *rec, size_t nwords);
+const stream_stats_t *stream_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,30 +1,57 @@
-#include "tmp117.h"
-#include "tmp117_registers.h"
+#include "temperature.h"
 #include "pico/stdlib.h"
 #include "pico/printf.h"
-#include "hardware/i2c.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include <stdbool.h>
 #include <stdint.h>
 
-#define SERIAL_INIT_DELAY_MS 1000 // adjust as needed to mitigate garbage characters after serial interface is started
-#define TMP117_I2C_SDA_PIN 4// set to a different SDA pin as needed
-#define TMP117_I2C_SCL_PIN 5 // set to a different SCL pin as needed
-#define TMP117_OFFSET_VALUE -25.0f  // temperature offset in degrees C set by user (try negative values for testing)
-#define TMP117_CONVERSION_DELAY_MS 1000 // Adjust the delay based on conversion cycle time and preference
+#define TEMP_REG_RESULT 0x00
+#define TEMP_REG_CONFIG 0x01
+#define TEMP_REG_DEVICE_ID TMP117_ID_REG
+#define TEMP_DEVICE_ID 0x0117 // DID; the top 4 bits are the revision
+#define TEMP_DEVICE_ID_MASK 0x0FFF
+#define TEMP_CONFIG_SOFT_RESET (1u << 1)
+#define TEMP_SOFT_RESET_MS 2 // EEPROM reload takes 1.5 ms
 
+static const i2c_device_t *temp_dev;
+
+static int temp_read_reg(uint8_t reg, uint16_t *o_val, uint64_t *o_time_us) {
+    uint8_t buf[2];
+    int ret = i2c_device_write_read(temp_dev, &reg, 1, buf, 2, o_time_us);
+    if (ret < 0)
+        return ret;
+    *o_val = (uint16_t)(buf[0] << 8 | buf[1]);
+    return 0;
+}
+
+static int temp_write_reg(uint8_t reg, uint16_t val) {
+    uint8_t buf[3] = {reg, val >> 8, val & 0xFF};
+    int ret = i2c_device_write(temp_dev, buf, sizeof buf);
+    return ret < 0 ? ret : 0;
+}
 
 // check if TMP117 is at the specified address and has correct device ID.
-void check_status(void) {
-    uint8_t address = tmp117_get_address();
-    int status = begin();
+void check_status(const i2c_device_t *dev) {
+    I2C_SITE(__func__);
+    uint8_t address = dev->addr;
+    uint16_t id;
+    int status;
+
+    temp_dev = dev;
+    status = temp_read_reg(TEMP_REG_DEVICE_ID, &id, NULL);
+    if (status == 0 && (id & TEMP_DEVICE_ID_MASK) != TEMP_DEVICE_ID)
+        status = TEMPERATURE_ID_NOT_FOUND;
 
     switch (status) {
-        case TMP117_OK:
+        case TEMPERATURE_OK:
             printf("\nTMP117 found at address 0x%02X, I2C frequency \n", address);
             break;
 
         case PICO_ERROR_TIMEOUT:
-            printf("\nI2C timeout reached after %u microseconds\n", SMBUS_TIMEOUT_US);
+            printf("\nI2C timeout reached after %u microseconds\n",
+                   (unsigned)(dev->timeout_us ? dev->timeout_us : I2C_ENGINE_DEFAULT_TIMEOUT_US));
             while (1) {
                 tight_loop_contents();  // Halt execution if timeout occurs
             }
@@ -37,7 +64,7 @@ void check_status(void) {
             }
             break;
 
-        case TMP117_ID_NOT_FOUND:
+        case TEMPERATURE_ID_NOT_FOUND:
             printf("\nNon-TMP117 device found at address 0x%02X\n", address);
             while (1) {
                 tight_loop_contents();  // Halt execution if a wrong device is found
@@ -51,3 +78,173 @@ void check_status(void) {
             }
     }
 }
+
+// TMP117 software reset; loads EEPROM Power On Reset values
+int temperature_soft_reset(void) {
+    I2C_SITE(__func__);
+    int ret = temp_write_reg(TEMP_REG_CONFIG, TEMP_CONFIG_SOFT_RESET);
+    sleep_ms(TEMP_SOFT_RESET_MS);
+    return ret;
+}
+
+/*
+CONVERSION CYCLE AND DATA READY
+- temperature_configure writes CONFIGURATION directly: continuous conversion
+    mode, the chosen CONV and AVG, and ALERT in data ready mode (DR/Alert = 1,
+    active low)
+- with ALERT wired to a GPIO (temperature_enable_alert_irq), the falling edge
+    queues a TEMP_RESULT read on the I2C engine straight from the interrupt,
+    so the result is read as soon as it is valid. Reading TEMP_RESULT clears
+    Data_Ready and releases ALERT for the next conversion
+- without it, temperature_read polls CONFIGURATION.Data_Ready
+- every access goes through the I2C device given to check_status
+*/
+#define TEMP_CONFIG_DATA_READY (1u << 13)
+#define TEMP_CONFIG_CONV_SHIFT 7
+#define TEMP_CONFIG_AVG_SHIFT 5
+#define TEMP_CONFIG_DR_ALERT (1u << 2)
+// read-only flags and the self clearing reset bit
+#define TEMP_CONFIG_RW_MASK 0x0FFC
+// an ALERT edge this many cycles overdue means it was missed; poll once
+#define TEMP_ALERT_MISSED_CYCLES 2
+
+// minimum cycle per CONV, in ms, without averaging (15.5 ms rounded up)
+static const uint32_t CONV_CYCLE_MS[] = {16, 125, 250, 500, 1000, 4000, 8000, 16000};
+// time the averaged conversions themselves take, per AVG
+static const uint32_t AVG_ACTIVE_MS[] = {16, 125, 500, 1000};
+
+static uint32_t temp_cycle_ms = 1000; // power-on CONV and AVG
+static int temp_alert_gpio = -1;
+
+static uint8_t temp_result_reg = TEMP_REG_RESULT;
+static uint8_t temp_result_buf[2];
+static i2c_txn_t temp_result_txn;
+static volatile bool temp_ready;
+static int16_t temp_raw;
+static uint64_t temp_time_us;
+
+uint32_t temperature_cycle_ms(enum temperature_conv_t conv, enum temperature_avg_t avg) {
+    uint32_t cycle = CONV_CYCLE_MS[conv & 7];
+    uint32_t active = AVG_ACTIVE_MS[avg & 3];
+    return cycle > active ? cycle : active;
+}
+
+// returns 0 on success, a negative PICO_ERROR_* value otherwise
+int temperature_configure(enum temperature_conv_t conv, enum temperature_avg_t avg) {
+    I2C_SITE(__func__);
+    uint16_t config = (uint16_t)((conv & 7) << TEMP_CONFIG_CONV_SHIFT |
+                                 (avg & 3) << TEMP_CONFIG_AVG_SHIFT |
+                                 TEMP_CONFIG_DR_ALERT);
+    uint16_t check;
+    int ret = temp_write_reg(TEMP_REG_CONFIG, config);
+    if (ret < 0)
+        return ret;
+    ret = temp_read_reg(TEMP_REG_CONFIG, &check, NULL);
+    if (ret < 0)
+        return ret;
+    if ((check & TEMP_CONFIG_RW_MASK) != config)
+        return PICO_ERROR_GENERIC;
+    temp_cycle_ms = temperature_cycle_ms(conv, avg);
+    return 0;
+}
+
+// runs in interrupt context once the TEMP_RESULT read queued by the ALERT
+// edge has finished
+static void temp_result_done(i2c_txn_t *txn) {
+    if (txn->status != i2c_txn_done)
+        return; // ALERT stays low; temperature_read polls it free
+    temp_raw = (int16_t)(temp_result_buf[0] << 8 | temp_result_buf[1]);
+    temp_time_us = txn->complete_us;
+    temp_ready = true;
+}
+
+static void temp_alert_isr(void) {
+    if (temp_alert_gpio < 0 ||
+        !(gpio_get_irq_event_mask(temp_alert_gpio) & GPIO_IRQ_EDGE_FALL))
+        return;
+    gpio_acknowledge_irq(temp_alert_gpio, GPIO_IRQ_EDGE_FALL);
+    // still busy with the previous result: at most one read in flight
+    if (temp_result_txn.status == i2c_txn_queued ||
+        temp_result_txn.status == i2c_txn_busy)
+        return;
+    temp_result_txn = (i2c_txn_t){
+        .wr = &temp_result_reg,
+        .wr_len = 1,
+        .rd = temp_result_buf,
+        .rd_len = sizeof temp_result_buf,
+        .callback = temp_result_done,
+        .site = "temp_alert_isr"};
+    i2c_device_submit(temp_dev, &temp_result_txn);
+}
+
+// checks Data_Ready and reads the result if it is set; reading CONFIGURATION
+// also clears the flag and releases ALERT
+static bool temp_poll(void) {
+    I2C_SITE(__func__);
+    uint16_t config;
+    uint16_t result;
+    uint64_t time_us;
+    if (temp_read_reg(TEMP_REG_CONFIG, &config, NULL) < 0 ||
+        !(config & TEMP_CONFIG_DATA_READY))
+        return false;
+    if (temp_read_reg(TEMP_REG_RESULT, &result, &time_us) < 0)
+        return false;
+    temp_raw = (int16_t)result;
+    temp_time_us = time_us;
+    return true;
+}
+
+/*
+Returns true once for every new conversion, with the raw TEMP_RESULT (1/128
+degC per LSB) and the time its read completed. In interrupt mode this only
+takes what the ALERT interrupt read, unless that edge seems to have been lost.
+*/
+bool temperature_read(int16_t *o_raw, uint64_t *o_time_us) {
+    bool ready;
+    if (temp_alert_gpio < 0) {
+        ready = temp_poll();
+    } else {
+        uint32_t saved = save_and_disable_interrupts();
+        ready = temp_ready;
+        temp_ready = false;
+        restore_interrupts(saved);
+        if (!ready && time_us_64() - temp_time_us >
+                          (uint64_t)TEMP_ALERT_MISSED_CYCLES * temp_cycle_ms * 1000)
+            ready = temp_poll();
+    }
+    if (!ready)
+        return false;
+    *o_raw = temp_raw;
+    if (o_time_us)
+        *o_time_us = temp_time_us;
+    return true;
+}
+
+/*
+Switches data ready detection to the ALERT pin on gpio (open drain, the
+internal pull-up is enabled). Waits up to two conversion cycles for the first
+interrupt to prove the wiring; returns false and keeps polling if none comes.
+*/
+bool temperature_enable_alert_irq(unsigned int gpio) {
+    absolute_time_t deadline;
+    gpio_init(gpio);
+    gpio_set_dir(gpio, GPIO_IN);
+    gpio_pull_up(gpio);
+    temp_alert_gpio = gpio;
+    temp_ready = false;
+    gpio_add_raw_irq_handler(gpio, temp_alert_isr);
+    gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    // a conversion that finished before the handler was installed holds
+    // ALERT low; reading it releases the pin for the next edge
+    temp_poll();
+    deadline = make_timeout_time_ms(TEMP_ALERT_MISSED_CYCLES * temp_cycle_ms);
+    while (!temp_ready)
+        if (time_reached(deadline)) {
+            gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_FALL, false);
+            gpio_remove_raw_irq_handler(gpio, temp_alert_isr);
+            temp_alert_gpio = -1;
+            return false;
+        }
+    return true;
+}
@@ -1,6 +1,41 @@
 #ifndef TEMPATURE_H
 #define TEMPATURE_H
 
-void check_status(void);
+#include <stdbool.h>
+#include <stdint.h>
+#include "i2c_device.h"
+
+#define TMP117_ADDRESS 0x48 // ADD0 to GND
+#define TMP117_MAX_HZ 400000
+#define TMP117_ID_REG 0x0F  // DEVICE_ID
+#define TEMPERATURE_OK 0
+#define TEMPERATURE_ID_NOT_FOUND -5
+
+// CONFIGURATION.CONV, named by the conversion cycle without averaging
+enum temperature_conv_t {
+    temperature_conv_15_5ms,
+    temperature_conv_125ms,
+    temperature_conv_250ms,
+    temperature_conv_500ms,
+    temperature_conv_1s,
+    temperature_conv_4s,
+    temperature_conv_8s,
+    temperature_conv_16s
+};
+
+// CONFIGURATION.AVG: conversions averaged per result
+enum temperature_avg_t {
+    temperature_avg_1,
+    temperature_avg_8,
+    temperature_avg_32,
+    temperature_avg_64
+};
+
+void check_status(const i2c_device_t *dev);
+int temperature_soft_reset(void);
+int temperature_configure(enum temperature_conv_t conv, enum temperature_avg_t avg);
+uint32_t temperature_cycle_ms(enum temperature_conv_t conv, enum temperature_avg_t avg);
+bool temperature_enable_alert_irq(unsigned int gpio);
+bool temperature_read(int16_t *o_raw, uint64_t *o_time_us);
 
 #endif
@@ -0,0 +1,92 @@
+// Compares the VEML6075 fixed-point path (SENSORS_FIXED_POINT) with the float
+// one it replaces, over random snapshots.
+//
+//   fixed_point_check [snapshots=200000] [seed=1]
+//
+// Both are the firmware's own functions from veml6075.c: the compensated
+// UVA/UVB counts against veml6075_snapshot_uva/uvb, and the Q16 UV index
+// against veml6075_snapshot_index. Snapshots cover every integration time,
+// both dynamic settings and the full 16-bit count range. The largest
+// differences are printed; the exit status is 1 if one is beyond what the
+// rounding of the Q16 and Q32 constants explains.
+
+extern "C" {
+#include "fixed_point.h"
+#include "veml6075.h"
+}
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+// Each Q16 coefficient (2.22, 1.33, 2.95, 1.75) is within half a step of its
+// value; times two 16-bit compensation counts that is up to one count. Then
+// the result is rounded to whole counts.
+constexpr double COEF_COUNTS = 2 * 0.5 * UINT16_MAX / Q16_ONE;
+constexpr double COUNTS_LIMIT = COEF_COUNTS + 0.5;
+// those counts at the largest responsivity (UVB at 50 ms, 0.00249 per count),
+// doubled in high dynamic mode, plus the truncation to Q16
+constexpr double INDEX_LIMIT = 2 * COEF_COUNTS * 0.00249 + 2.0 / Q16_ONE;
+
+struct Worst {
+    double diff = 0;
+    veml6075_snapshot_t snap{};
+
+    void add(double d, const veml6075_snapshot_t &s)
+    {
+        if (std::fabs(d) > std::fabs(diff)) {
+            diff = d;
+            snap = s;
+        }
+    }
+
+    void print(const char *what, double limit) const
+    {
+        std::printf("%-10s max |diff| %.3g (limit %.3g)  uva %u uvb %u comp1 %u comp2 %u it %d hd %d\n",
+                    what, std::fabs(diff), limit, snap.uva, snap.uvb, snap.comp1, snap.comp2,
+                    (int)snap.it, (int)snap.hd);
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned long n = argc > 1 ? std::strtoul(argv[1], nullptr, 0) : 200000;
+    unsigned long seed = argc > 2 ? std::strtoul(argv[2], nullptr, 0) : 1;
+    if (n == 0) {
+        std::fprintf(stderr, "usage: fixed_point_check [snapshots=200000] [seed=1]\n");
+        return 2;
+    }
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<unsigned> count(0, UINT16_MAX);
+    std::uniform_int_distribution<int> it(IT_50MS, IT_800MS);
+    VEML6075_t dev{}; // only its last_index is written
+    Worst uva, uvb, index;
+    for (unsigned long i = 0; i < n; i++) {
+        veml6075_snapshot_t snap{};
+        snap.uva = (uint16_t)count(rng);
+        snap.uvb = (uint16_t)count(rng);
+        snap.comp1 = (uint16_t)count(rng);
+        snap.comp2 = (uint16_t)count(rng);
+        snap.it = (veml6075_uv_it_t)it(rng);
+        snap.hd = rng() & 1;
+        uva.add(veml6075_snapshot_uva_counts(&snap) - (double)veml6075_snapshot_uva(&snap), snap);
+        uvb.add(veml6075_snapshot_uvb_counts(&snap) - (double)veml6075_snapshot_uvb(&snap), snap);
+        index.add((double)veml6075_snapshot_index_q16(&snap) / Q16_ONE -
+                      (double)veml6075_snapshot_index(&dev, &snap),
+                  snap);
+    }
+    std::printf("%lu snapshots, seed %lu\n", n, seed);
+    uva.print("UVA", COUNTS_LIMIT);
+    uvb.print("UVB", COUNTS_LIMIT);
+    index.print("UV index", INDEX_LIMIT);
+    bool ok = std::fabs(uva.diff) <= COUNTS_LIMIT && std::fabs(uvb.diff) <= COUNTS_LIMIT &&
+              std::fabs(index.diff) <= INDEX_LIMIT;
+    std::printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+// Host stand-in for lib/sd's f_util.h
+#ifndef HOST_F_UTIL_H
+#define HOST_F_UTIL_H
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char *FRESULT_str(FRESULT i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+// Host stand-in for FatFs's ff.h (lib/sd): the card is a directory of the
+// host, one file per file on the card, see ff_host.c. Only what logging.c
+// uses, with the firmware's ffconf.h options.
+#ifndef HOST_FF_H
+#define HOST_FF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FF_USE_EXPAND 1
+#define FF_USE_FASTSEEK 1
+
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef char TCHAR;
+typedef uint64_t FSIZE_t;
+
+typedef enum
+{
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+    FR_EXIST,
+    FR_INVALID_OBJECT,
+    FR_WRITE_PROTECTED,
+    FR_INVALID_DRIVE,
+    FR_NOT_ENABLED,
+    FR_NO_FILESYSTEM,
+    FR_MKFS_ABORTED,
+    FR_TIMEOUT,
+    FR_LOCKED,
+    FR_NOT_ENOUGH_CORE,
+    FR_TOO_MANY_OPEN_FILES,
+    FR_INVALID_PARAMETER
+} FRESULT;
+
+typedef struct
+{
+    WORD csize; // sectors per cluster
+} FATFS;
+
+typedef struct
+{
+    FSIZE_t fptr;
+    FSIZE_t objsize;
+    DWORD *cltbl; // fast seek mode when set: the file cannot grow
+    int fd;
+} FIL;
+
+typedef struct
+{
+    FSIZE_t fsize;
+} FILINFO;
+
+#define FA_READ 0x01
+#define FA_WRITE 0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW 0x04
+#define CREATE_LINKMAP ((FSIZE_t)0 - 1)
+
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt);
+FRESULT f_unmount(const TCHAR *path);
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, BYTE opt);
+FRESULT f_stat(const TCHAR *path, FILINFO *fno);
+
+#define f_tell(fp) ((fp)->fptr)
+#define f_size(fp) ((fp)->objsize)
+
+// host only: the directory that f_mount makes the card
+void ff_host_mount_dir(const char *dir);
+// the power goes during the f_write after this many more (-1: never): it
+// writes part of its data, like a card losing power mid-transfer, and the
+// process exits with FF_HOST_CUT_EXIT
+void ff_host_cut_after(long writes);
+// f_write calls so far
+long ff_host_writes(void);
+#define FF_HOST_CUT_EXIT 3
+// what f_expand leaves in a new file: whatever the card held before
+#define FF_HOST_STALE_BYTE 0xA5
+#define FF_HOST_CLUSTER_SECTORS 16
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
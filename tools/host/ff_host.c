@@ -0,0 +1,188 @@
+/*
+FATFS STAND-IN
+- the card is a directory of the host (ff_host_mount_dir) and every file on
+    it a host file of the same name; offsets, sizes and truncation map
+    one to one, so the files can be read back like the card's
+- f_expand allocates in place and leaves FF_HOST_STALE_BYTE in the file, as
+    a card hands back whatever its clusters held; in fast seek mode (cltbl
+    set) a file cannot grow past its size, as in FatFs
+- ff_host_cut_after simulates a power loss: the chosen f_write lands only
+    partly (half its bytes plus a few, so a block is torn) and the process
+    exits on the spot, without closing or syncing anything
+*/
+#include "f_util.h"
+#include "ff.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char card_dir[256] = ".";
+static long cut_after = -1;
+static long writes;
+
+void ff_host_mount_dir(const char *dir)
+{
+    snprintf(card_dir, sizeof card_dir, "%s", dir);
+}
+
+void ff_host_cut_after(long n)
+{
+    cut_after = n;
+}
+
+long ff_host_writes(void)
+{
+    return writes;
+}
+
+static const char *card_path(const TCHAR *path)
+{
+    static char full[512];
+    snprintf(full, sizeof full, "%s/%s", card_dir, path);
+    return full;
+}
+
+const char *FRESULT_str(FRESULT i)
+{
+    static const char *const names[] = {
+        "ok", "disk error", "internal error", "not ready", "no file", "no path",
+        "invalid name", "denied", "exists", "invalid object", "write protected",
+        "invalid drive", "not enabled", "no filesystem", "mkfs aborted", "timeout",
+        "locked", "not enough core", "too many open files", "invalid parameter"};
+    if ((unsigned)i < sizeof names / sizeof *names)
+        return names[i];
+    return "unknown";
+}
+
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt)
+{
+    struct stat st;
+    (void)path;
+    (void)opt;
+    if (stat(card_dir, &st) != 0 || !S_ISDIR(st.st_mode))
+        return FR_NOT_READY;
+    fs->csize = FF_HOST_CLUSTER_SECTORS;
+    return FR_OK;
+}
+
+FRESULT f_unmount(const TCHAR *path)
+{
+    (void)path;
+    return FR_OK;
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+    struct stat st;
+    int flags = O_RDWR;
+    int fd;
+    if (mode & FA_CREATE_NEW)
+        flags |= O_CREAT | O_EXCL;
+    fd = open(card_path(path), flags, 0644);
+    if (fd < 0)
+        return errno == EEXIST ? FR_EXIST : FR_NO_FILE;
+    fstat(fd, &st);
+    *fp = (FIL){.fptr = 0, .objsize = (FSIZE_t)st.st_size, .cltbl = NULL, .fd = fd};
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+    close(fp->fd);
+    fp->fd = -1;
+    return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+    ssize_t n = pread(fp->fd, buff, btr, (off_t)fp->fptr);
+    if (n < 0)
+        return FR_DISK_ERR;
+    *br = (UINT)n;
+    fp->fptr += (UINT)n;
+    return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    if (writes++ == cut_after)
+    {
+        // the rest of this write, and everything after it, never happens
+        UINT landed = btw / 2 + 7 < btw ? btw / 2 + 7 : btw / 2;
+        if (pwrite(fp->fd, buff, landed, (off_t)fp->fptr) < 0)
+            _exit(1);
+        _exit(FF_HOST_CUT_EXIT);
+    }
+    // fast seek mode has no cluster to grow into
+    if (fp->cltbl && fp->fptr + btw > fp->objsize)
+        btw = fp->fptr < fp->objsize ? (UINT)(fp->objsize - fp->fptr) : 0;
+    if (pwrite(fp->fd, buff, btw, (off_t)fp->fptr) != (ssize_t)btw)
+        return FR_DISK_ERR;
+    *bw = btw;
+    fp->fptr += btw;
+    if (fp->fptr > fp->objsize)
+        fp->objsize = fp->fptr;
+    return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    if (ofs == CREATE_LINKMAP)
+        return FR_OK; // the host file is its own cluster map
+    if (ofs > fp->objsize)
+    {
+        if (fp->cltbl)
+            ofs = fp->objsize;
+        else if (ftruncate(fp->fd, (off_t)ofs) != 0)
+            return FR_DISK_ERR;
+        else
+            fp->objsize = ofs;
+    }
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp)
+{
+    if (ftruncate(fp->fd, (off_t)fp->fptr) != 0)
+        return FR_DISK_ERR;
+    fp->objsize = fp->fptr;
+    return FR_OK;
+}
+
+FRESULT f_sync(FIL *fp)
+{
+    (void)fp;
+    return FR_OK;
+}
+
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, BYTE opt)
+{
+    static uint8_t stale[4096];
+    (void)opt;
+    if (fp->objsize != 0)
+        return FR_DENIED;
+    memset(stale, FF_HOST_STALE_BYTE, sizeof stale);
+    for (FSIZE_t ofs = 0; ofs < fsz; ofs += sizeof stale)
+    {
+        size_t n = fsz - ofs < sizeof stale ? (size_t)(fsz - ofs) : sizeof stale;
+        if (pwrite(fp->fd, stale, n, (off_t)ofs) != (ssize_t)n)
+            return FR_DISK_ERR;
+    }
+    fp->objsize = fsz;
+    return FR_OK;
+}
+
+FRESULT f_stat(const TCHAR *path, FILINFO *fno)
+{
+    struct stat st;
+    if (stat(card_path(path), &st) != 0)
+        return FR_NO_FILE;
+    if (fno)
+        fno->fsize = (FSIZE_t)st.st_size;
+    return FR_OK;
+}
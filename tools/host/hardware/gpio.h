@@ -0,0 +1,57 @@
+// Host stand-in for the Pico SDK's hardware/gpio.h. There are no pins: the
+// calls do nothing and no edge ever arrives, so drivers that would wait for
+// an interrupt fall back to polling the device.
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GPIO_IN 0
+#define GPIO_OUT 1
+#define IO_IRQ_BANK0 21
+
+enum gpio_function
+{
+    GPIO_FUNC_I2C = 3
+};
+
+enum gpio_irq_level
+{
+    GPIO_IRQ_LEVEL_LOW = 1,
+    GPIO_IRQ_LEVEL_HIGH = 2,
+    GPIO_IRQ_EDGE_FALL = 4,
+    GPIO_IRQ_EDGE_RISE = 8
+};
+
+static inline void gpio_init(unsigned int gpio) { (void)gpio; }
+static inline void gpio_set_dir(unsigned int gpio, bool out) { (void)gpio, (void)out; }
+static inline void gpio_pull_up(unsigned int gpio) { (void)gpio; }
+static inline void gpio_pull_down(unsigned int gpio) { (void)gpio; }
+static inline void gpio_set_function(unsigned int gpio, enum gpio_function fn)
+{
+    (void)gpio, (void)fn;
+}
+static inline void gpio_set_irq_enabled(unsigned int gpio, uint32_t events, bool enabled)
+{
+    (void)gpio, (void)events, (void)enabled;
+}
+static inline void gpio_add_raw_irq_handler(unsigned int gpio, void (*handler)(void))
+{
+    (void)gpio, (void)handler;
+}
+static inline void gpio_remove_raw_irq_handler(unsigned int gpio, void (*handler)(void))
+{
+    (void)gpio, (void)handler;
+}
+static inline uint32_t gpio_get_irq_event_mask(unsigned int gpio)
+{
+    (void)gpio;
+    return 0;
+}
+static inline void gpio_acknowledge_irq(unsigned int gpio, uint32_t events)
+{
+    (void)gpio, (void)events;
+}
+
+#endif
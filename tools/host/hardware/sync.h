@@ -0,0 +1,13 @@
+// Host stand-in for the Pico SDK's hardware/sync.h; single threaded, no IRQs
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+static inline void __wfe(void) {}
+static inline void __sev(void) {}
+static inline void __dmb(void) {}
+
+#endif
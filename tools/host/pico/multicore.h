@@ -0,0 +1,15 @@
+// Host stand-in for the Pico SDK's pico/multicore.h. There is no second core:
+// the tools call logging_init and write_result directly instead of
+// logging_start_core1, and nothing ever arrives in the FIFO.
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+static inline void multicore_launch_core1(void (*entry)(void)) { (void)entry; }
+static inline void multicore_fifo_push_blocking(uint32_t data) { (void)data; }
+static inline uint32_t multicore_fifo_pop_blocking(void) { return 0; }
+static inline bool multicore_fifo_rvalid(void) { return false; }
+
+#endif
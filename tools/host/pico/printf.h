@@ -0,0 +1,7 @@
+// Host stand-in for the Pico SDK's pico/printf.h
+#ifndef HOST_PICO_PRINTF_H
+#define HOST_PICO_PRINTF_H
+
+#include <stdio.h>
+
+#endif
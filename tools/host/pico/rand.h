@@ -0,0 +1,17 @@
+// Host stand-in for the Pico SDK's pico/rand.h, see pico_host.c
+#ifndef HOST_PICO_RAND_H
+#define HOST_PICO_RAND_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t get_rand_32(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
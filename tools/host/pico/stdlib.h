@@ -0,0 +1,34 @@
+// Host stand-in for the Pico SDK's pico/stdlib.h, for tools/sensors_host.
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+#ifndef MIN
+#define MIN(a, b) ((b) < (a) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+#define __not_in_flash_func(f) f
+#define __time_critical_func(f) f
+
+static inline void tight_loop_contents(void) {}
+static inline bool stdio_init_all(void) { return true; }
+static inline int putchar_raw(int c) { return putchar(c); }
+// no console input on the host
+static inline int getchar_timeout_us(uint32_t timeout_us)
+{
+    (void)timeout_us;
+    return PICO_ERROR_TIMEOUT;
+}
+
+#endif
@@ -0,0 +1,42 @@
+// Host stand-in for the Pico SDK's pico/time.h: a virtual clock, see
+// pico_host.c. Only what the drivers use.
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+void sleep_until(absolute_time_t t);
+// moves the virtual clock forward without sleeping "in" the firmware
+void host_advance_us(uint64_t us);
+
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + 1000ull * ms; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return time_us_64() + us; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return time_us_64() + 1000ull * ms; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return (int64_t)(to - from);
+}
+static inline bool time_reached(absolute_time_t t) { return time_us_64() >= t; }
+static inline void sleep_us(uint64_t us) { sleep_until(time_us_64() + us); }
+static inline void sleep_ms(uint32_t ms) { sleep_until(time_us_64() + 1000ull * ms); }
+static inline void busy_wait_us(uint64_t us) { sleep_us(us); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/*
+VIRTUAL CLOCK
+- time only moves when the firmware sleeps, when the simulated bus holds a
+    transaction (host_advance_us) and by 1 us per time_us_64() call, so
+    loops that poll the clock still reach their deadlines
+- runs as fast as the host can go; every timestamp the firmware records is
+    as it would be on the Pico with the bus as the only cost
+*/
+#include "pico/rand.h"
+#include "pico/time.h"
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t host_now_us;
+
+uint64_t time_us_64(void)
+{
+    return host_now_us++;
+}
+
+void sleep_until(absolute_time_t t)
+{
+    if (t > host_now_us)
+        host_now_us = t;
+}
+
+void host_advance_us(uint64_t us)
+{
+    host_now_us += us;
+}
+
+// xorshift64, seeded per process: every run, like every boot, draws
+// different numbers even though the virtual clock always starts at 0
+uint32_t get_rand_32(void)
+{
+    static uint64_t state;
+    if (state == 0)
+        state = ((uint64_t)getpid() << 32 ^ (uint64_t)time(NULL)) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)(state >> 32);
+}
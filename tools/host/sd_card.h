@@ -0,0 +1,8 @@
+// Host stand-in for lib/sd's sd_card.h, for ../hw_config.h; the card itself
+// is ff_host.c's directory
+#ifndef HOST_SD_CARD_H
+#define HOST_SD_CARD_H
+
+typedef struct sd_card_t sd_card_t;
+
+#endif
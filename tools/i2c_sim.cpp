@@ -0,0 +1,532 @@
+#include "i2c_sim.h"
+
+extern "C" {
+#include "pico/time.h"
+}
+
+#include <cmath>
+
+namespace {
+
+// I2C specification minimum timings, ns
+struct ModeTiming {
+    uint32_t max_hz;
+    uint32_t hd_sta; // START hold
+    uint32_t su_sta; // repeated START setup
+    uint32_t su_sto; // STOP setup
+    uint32_t buf;    // bus free between STOP and START
+};
+
+const ModeTiming MODES[] = {
+    {100000, 4000, 4700, 4000, 4700},  // Sm
+    {400000, 600, 600, 600, 1300},     // Fm
+    {1000000, 260, 260, 260, 500},     // Fm+
+};
+
+const ModeTiming &mode_for(uint32_t hz)
+{
+    for (const ModeTiming &m : MODES)
+        if (hz <= m.max_hz)
+            return m;
+    return MODES[2];
+}
+
+// small deterministic noise, +-1
+class Noise {
+public:
+    explicit Noise(uint32_t seed) : s_(seed) {}
+    double next()
+    {
+        s_ ^= s_ << 13;
+        s_ ^= s_ >> 17;
+        s_ ^= s_ << 5;
+        return (s_ & 0xFFFF) / 32767.5 - 1;
+    }
+
+private:
+    uint32_t s_;
+};
+
+Noise noise(0x2545F491);
+
+double seconds(uint64_t us) { return us / 1e6; }
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// bus
+
+void sim_bus_start(void *ctx, i2c_txn_t *txn)
+{
+    SimBus *bus = static_cast<SimBus *>(ctx);
+    SimDevice *dev = bus->find(txn->addr);
+    uint64_t ns = bus->wire_ns(txn, dev && bus->hz_ <= dev->max_hz ? dev : nullptr) +
+                  bus->carry_ns_;
+    host_advance_us(ns / 1000);
+    bus->carry_ns_ = ns % 1000;
+    if (dev == nullptr) {
+        i2c_engine_complete(&bus->eng, i2c_txn_nack);
+        return;
+    }
+    uint64_t now = time_us_64();
+    dev->stats.txns++;
+    dev->stats.bus_ns += ns - bus->carry_ns_;
+    dev->stats.hz = bus->hz_;
+    if (bus->hz_ > dev->max_hz) {
+        dev->stats.overspeed++;
+        i2c_engine_complete(&bus->eng, i2c_txn_nack);
+        return;
+    }
+    dev->stats.bytes += txn->wr_len + txn->rd_len;
+    if (txn->wr_len) {
+        dev->select(txn->wr[0]);
+        dev->write(now, txn->wr + 1, txn->wr_len - 1u);
+    }
+    if (txn->rd_len)
+        dev->read(now, txn->rd, txn->rd_len);
+    i2c_engine_complete(&bus->eng, i2c_txn_done);
+}
+
+void sim_bus_set_hz(void *ctx, uint32_t hz)
+{
+    SimBus *bus = static_cast<SimBus *>(ctx);
+    uint64_t ns = SIM_HZ_SWITCH_NS + bus->carry_ns_;
+    host_advance_us(ns / 1000);
+    bus->carry_ns_ = ns % 1000;
+    bus->hz_ = hz;
+}
+
+namespace {
+
+void sim_bus_abort(void *) {}
+
+uint32_t sim_bus_lock(void *) { return 0; }
+
+void sim_bus_unlock(void *, uint32_t) {}
+
+uint64_t sim_bus_now_us(void *) { return time_us_64(); }
+
+// transactions complete inside start, so a waiter only ever sees a finished one
+void sim_bus_idle(void *) { host_advance_us(1); }
+
+const i2c_engine_backend_t sim_bus_backend = {
+    sim_bus_start, sim_bus_abort, sim_bus_lock, sim_bus_unlock,
+    sim_bus_now_us, sim_bus_idle, sim_bus_set_hz,
+};
+
+} // namespace
+
+SimBus::SimBus(uint32_t hz) : hz_(hz) { i2c_engine_init(&eng, &sim_bus_backend, this); }
+
+SimDevice *SimBus::find(uint8_t addr) const
+{
+    for (SimDevice *d : devices_)
+        if (d->addr == addr)
+            return d;
+    return nullptr;
+}
+
+uint64_t SimBus::wire_ns(const i2c_txn_t *txn, const SimDevice *dev) const
+{
+    const ModeTiming &m = mode_for(hz_);
+    uint64_t clock_ns = 1000000000ull / hz_;
+    uint64_t ns = m.hd_sta + 9 * clock_ns; // START, address + ACK
+    if (dev != nullptr) {
+        ns += 9 * clock_ns * txn->wr_len;
+        if (txn->rd_len) {
+            if (txn->wr_len)
+                ns += m.su_sta + m.hd_sta + 9 * clock_ns; // repeated START, address
+            ns += (9 * clock_ns + dev->stretch_ns()) * txn->rd_len;
+        }
+    }
+    return ns + m.su_sto + m.buf; // STOP, bus free
+}
+
+void SimBus::reset_stats()
+{
+    eng.stats = i2c_engine_stats_t{};
+    i2c_engine_profile_reset(&eng);
+    for (SimDevice *d : devices_)
+        d->stats = SimDeviceStats{};
+}
+
+// ---------------------------------------------------------------------------
+// BMP581
+
+namespace {
+
+enum : uint8_t {
+    BMP_CHIP_ID = 0x01,
+    BMP_INT_SOURCE = 0x15,
+    BMP_TEMP_XLSB = 0x1D,
+    BMP_PRESS_XLSB = 0x20,
+    BMP_INT_STATUS = 0x27,
+    BMP_STATUS = 0x28,
+    BMP_OSR_CONFIG = 0x36,
+    BMP_ODR_CONFIG = 0x37,
+    BMP_OSR_EFF = 0x38,
+    BMP_CMD = 0x7E,
+};
+
+const uint32_t BMP_ODR_MHZ[32] = {
+    240000, 218500, 199100, 179200, 160000, 149300, 140000, 129800,
+    120000, 110100, 100200, 89600, 80000, 70000, 60000, 50000,
+    45000, 40000, 35000, 30000, 25000, 20000, 15000, 10000,
+    5000, 4000, 3000, 2000, 1000, 500, 250, 125};
+
+enum : uint8_t { BMP_STANDBY, BMP_NORMAL, BMP_FORCED, BMP_CONTINUOUS };
+
+} // namespace
+
+SimBmp581::SimBmp581() : SimDevice("bmp581", 0x47, 3400000)
+{
+    regs_[BMP_CHIP_ID] = 0x50;
+    regs_[BMP_STATUS] = 0x02; // nvm_rdy
+    regs_[BMP_ODR_CONFIG] = 0x70; // standby, 1 Hz, deep standby enabled
+}
+
+// approximately linear in the number of samples averaged
+uint64_t SimBmp581::measurement_us() const
+{
+    uint8_t osr = regs_[BMP_OSR_CONFIG];
+    return 400 + 330 * (1u << (osr >> 3 & 7)) + 80 * (1u << (osr & 7));
+}
+
+void SimBmp581::update(uint64_t now_us)
+{
+    uint8_t mode = regs_[BMP_ODR_CONFIG] & 3;
+    uint64_t period_us = 1000000000ull / BMP_ODR_MHZ[regs_[BMP_ODR_CONFIG] >> 2 & 31];
+    if (mode == BMP_CONTINUOUS)
+        period_us = measurement_us();
+    if (mode == BMP_STANDBY || now_us < next_sample_us_)
+        return;
+    double t = seconds(next_sample_us_);
+    int32_t press = (int32_t)std::lround((101325.0 - 12.0 * t + 0.8 * noise.next()) * 64);
+    int32_t temp = (int32_t)std::lround((21.5 - 0.01 * t + 0.005 * noise.next()) * 65536);
+    for (int i = 0; i < 3; i++) {
+        regs_[BMP_TEMP_XLSB + i] = (uint8_t)(temp >> (8 * i));
+        regs_[BMP_PRESS_XLSB + i] = (uint8_t)(press >> (8 * i));
+    }
+    if (regs_[BMP_INT_SOURCE] & 0x01)
+        regs_[BMP_INT_STATUS] |= 0x01;
+    if (mode == BMP_FORCED) {
+        regs_[BMP_ODR_CONFIG] &= ~3; // one measurement, then standby
+        return;
+    }
+    // samples missed while nobody looked are overwritten, not queued
+    next_sample_us_ += (now_us - next_sample_us_) / period_us * period_us + period_us;
+}
+
+void SimBmp581::write(uint64_t now_us, const uint8_t *src, size_t len)
+{
+    update(now_us);
+    for (size_t i = 0; i < len; i++, reg_++) {
+        uint8_t reg = reg_ & 0x7F;
+        if (reg == BMP_CMD) {
+            if (src[i] == 0xB6) { // soft reset
+                SimDeviceStats kept = stats;
+                *this = SimBmp581();
+                stats = kept;
+            }
+            continue;
+        }
+        if (reg == BMP_INT_STATUS || reg == BMP_STATUS || reg == BMP_OSR_EFF ||
+            reg == BMP_CHIP_ID)
+            continue;
+        regs_[reg] = src[i];
+        if (reg == BMP_ODR_CONFIG || reg == BMP_OSR_CONFIG) {
+            uint8_t mode = regs_[BMP_ODR_CONFIG] & 3;
+            uint64_t period_us =
+                1000000000ull / BMP_ODR_MHZ[regs_[BMP_ODR_CONFIG] >> 2 & 31];
+            uint8_t osr = regs_[BMP_OSR_CONFIG] & 0x3F;
+            bool valid = mode != BMP_NORMAL || measurement_us() <= period_us;
+            // the device lowers osr_p until a measurement fits the period
+            while (!valid && (osr >> 3) > 0) {
+                osr -= 1 << 3;
+                uint8_t saved = regs_[BMP_OSR_CONFIG];
+                regs_[BMP_OSR_CONFIG] = osr;
+                bool fits = measurement_us() <= period_us;
+                regs_[BMP_OSR_CONFIG] = saved;
+                if (fits)
+                    break;
+            }
+            regs_[BMP_OSR_EFF] = (uint8_t)(osr | (valid ? 0x80 : 0));
+            if (mode != BMP_STANDBY)
+                next_sample_us_ = now_us + measurement_us();
+        }
+    }
+}
+
+void SimBmp581::read(uint64_t now_us, uint8_t *dst, size_t len)
+{
+    update(now_us);
+    if (por_)
+        regs_[BMP_INT_STATUS] |= 0x10;
+    for (size_t i = 0; i < len; i++, reg_++) {
+        uint8_t reg = reg_ & 0x7F;
+        dst[i] = regs_[reg];
+        if (reg == BMP_INT_STATUS) { // clear on read
+            regs_[reg] = 0;
+            por_ = false;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// VEML6075
+
+namespace {
+
+enum : uint8_t {
+    VEML_UV_CONF = 0x00,
+    VEML_UVA = 0x07,
+    VEML_UVB = 0x09,
+    VEML_COMP1 = 0x0A,
+    VEML_COMP2 = 0x0B,
+    VEML_ID = 0x0C,
+};
+
+enum : uint16_t {
+    VEML_SD = 0x01,
+    VEML_AF = 0x02,
+    VEML_TRIG = 0x04,
+    VEML_HD = 0x08,
+};
+
+} // namespace
+
+SimVeml6075::SimVeml6075() : SimDevice("veml6075", 0x10, 400000)
+{
+    regs_[VEML_UV_CONF] = VEML_SD;
+    regs_[VEML_ID] = 0x0026;
+}
+
+void SimVeml6075::update(uint64_t now_us)
+{
+    uint16_t conf = regs_[VEML_UV_CONF];
+    uint32_t it_ms = 50u << ((conf >> 4) & 7);
+    if (conf & VEML_SD)
+        return;
+    if (!integrating_) {
+        if (conf & VEML_AF)
+            return;
+        integrating_ = true; // continuous mode runs back to back
+        done_us_ = now_us + it_ms * 1000ull;
+        return;
+    }
+    if (now_us < done_us_)
+        return;
+    // noon sun through thin cloud, counts per 100 ms of integration
+    double t = seconds(done_us_);
+    double sun = 1 + 0.2 * std::sin(t / 30) + 0.01 * noise.next();
+    double scale = it_ms / 100.0 / (conf & VEML_HD ? 2 : 1);
+    auto counts = [&](double per_100ms) {
+        double c = per_100ms * sun * scale;
+        return (uint16_t)(c > 65535 ? 65535 : c);
+    };
+    regs_[VEML_UVA] = counts(3600);
+    regs_[VEML_UVB] = counts(2400);
+    regs_[VEML_COMP1] = counts(420);
+    regs_[VEML_COMP2] = counts(310);
+    if (conf & VEML_AF) {
+        integrating_ = false;
+        regs_[VEML_UV_CONF] &= ~VEML_TRIG;
+    } else {
+        done_us_ += it_ms * 1000ull;
+    }
+}
+
+void SimVeml6075::write(uint64_t now_us, const uint8_t *src, size_t len)
+{
+    update(now_us);
+    high_ = false;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t reg = reg_ & 0x0F;
+        uint16_t r = regs_[reg];
+        r = high_ ? (uint16_t)((r & 0x00FF) | src[i] << 8) : (uint16_t)((r & 0xFF00) | src[i]);
+        if (high_)
+            reg_++;
+        high_ = !high_;
+        if (reg != VEML_UV_CONF)
+            continue; // the rest is read only
+        regs_[reg] = r;
+        if (high_)
+            continue; // UV_CONF takes effect once both bytes are in
+        if ((r & (VEML_SD | VEML_AF | VEML_TRIG)) == (VEML_AF | VEML_TRIG) && !integrating_) {
+            integrating_ = true;
+            // the integration runs a little long, within the datasheet tolerance
+            done_us_ = now_us + (50u << ((r >> 4) & 7)) * 1020ull;
+        }
+    }
+}
+
+void SimVeml6075::read(uint64_t now_us, uint8_t *dst, size_t len)
+{
+    update(now_us);
+    for (size_t i = 0; i < len; i++) {
+        uint16_t r = regs_[(reg_ + i / 2) & 0x0F];
+        dst[i] = (uint8_t)(i & 1 ? r >> 8 : r);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TMP117
+
+namespace {
+
+enum : uint8_t {
+    TMP_RESULT = 0x00,
+    TMP_CONFIG = 0x01,
+    TMP_DEVICE_ID = 0x0F,
+};
+
+enum : uint16_t {
+    TMP_CONFIG_DEFAULT = 0x0220, // continuous, CONV 4, AVG 8
+    TMP_SOFT_RESET = 0x0002,
+    TMP_DATA_READY = 0x2000,
+    TMP_MODE_SHUTDOWN = 0x0400,
+    TMP_MODE_ONE_SHOT = 0x0C00,
+    TMP_MODE_MASK = 0x0C00,
+};
+
+const uint32_t TMP_CONV_US[] = {15500, 125000, 250000, 500000, 1000000, 4000000, 8000000, 16000000};
+const uint32_t TMP_AVG_US[] = {15500, 125000, 500000, 1000000};
+
+} // namespace
+
+SimTmp117::SimTmp117() : SimDevice("tmp117", 0x48, 400000)
+{
+    regs_[TMP_CONFIG] = TMP_CONFIG_DEFAULT;
+    regs_[TMP_DEVICE_ID] = 0x0117;
+    next_conv_us_ = cycle_us();
+}
+
+uint64_t SimTmp117::cycle_us() const
+{
+    uint16_t config = regs_[TMP_CONFIG];
+    uint32_t active = TMP_AVG_US[config >> 5 & 3];
+    uint32_t cycle = TMP_CONV_US[config >> 7 & 7];
+    if ((config & TMP_MODE_MASK) == TMP_MODE_ONE_SHOT)
+        return active;
+    return cycle > active ? cycle : active;
+}
+
+void SimTmp117::update(uint64_t now_us)
+{
+    uint16_t mode = regs_[TMP_CONFIG] & TMP_MODE_MASK;
+    if (mode == TMP_MODE_SHUTDOWN || now_us < next_conv_us_)
+        return;
+    double t = seconds(next_conv_us_);
+    double temp = 24.0 + std::sin(t / 60) + 0.008 * noise.next();
+    regs_[TMP_RESULT] = (uint16_t)(int16_t)std::lround(temp * 128);
+    regs_[TMP_CONFIG] |= TMP_DATA_READY;
+    if (mode == TMP_MODE_ONE_SHOT) {
+        regs_[TMP_CONFIG] = (uint16_t)((regs_[TMP_CONFIG] & ~TMP_MODE_MASK) | TMP_MODE_SHUTDOWN);
+        return;
+    }
+    uint64_t cycle = cycle_us();
+    next_conv_us_ += (now_us - next_conv_us_) / cycle * cycle + cycle;
+}
+
+void SimTmp117::write(uint64_t now_us, const uint8_t *src, size_t len)
+{
+    update(now_us);
+    npending_ = 0;
+    for (size_t i = 0; i < len; i++) {
+        pending_[npending_++] = src[i];
+        if (npending_ < 2)
+            continue;
+        npending_ = 0;
+        uint8_t reg = reg_++ & 0x0F;
+        uint16_t val = (uint16_t)(pending_[0] << 8 | pending_[1]);
+        if (reg == TMP_DEVICE_ID || reg == TMP_RESULT)
+            continue;
+        if (reg == TMP_CONFIG) {
+            if (val & TMP_SOFT_RESET) {
+                SimDeviceStats kept = stats;
+                *this = SimTmp117();
+                stats = kept;
+                next_conv_us_ = now_us + 1500 + cycle_us(); // EEPROM reload
+                continue;
+            }
+            // a new mode restarts the conversion cycle
+            val = (uint16_t)((val & 0x0FFC) | (regs_[TMP_CONFIG] & 0xE000));
+            regs_[TMP_CONFIG] = val;
+            next_conv_us_ = now_us + cycle_us();
+            continue;
+        }
+        regs_[reg] = val;
+    }
+}
+
+void SimTmp117::read(uint64_t now_us, uint8_t *dst, size_t len)
+{
+    update(now_us);
+    uint8_t reg = reg_ & 0x0F;
+    uint16_t r = regs_[reg];
+    for (size_t i = 0; i < len; i++)
+        dst[i] = (uint8_t)(i & 1 ? r : r >> 8);
+    if (reg == TMP_CONFIG || reg == TMP_RESULT)
+        regs_[TMP_CONFIG] &= ~TMP_DATA_READY;
+}
+
+// ---------------------------------------------------------------------------
+// CMPS12
+
+SimCmps12::SimCmps12() : SimDevice("cmps12", 0x60, 400000)
+{
+    regs_[0x00] = 0x05; // software version
+    regs_[0x1E] = 0xFF; // fully calibrated
+}
+
+void SimCmps12::update(uint64_t now_us)
+{
+    if (now_us < next_update_us_)
+        return;
+    next_update_us_ = now_us - now_us % 10000 + 10000;
+    double t = seconds(now_us - now_us % 10000);
+    const double pi = 3.14159265358979;
+    double heading = std::fmod(30 * t + 15 * std::sin(2 * pi * 0.3 * t), 360);
+    if (heading < 0)
+        heading += 360;
+    double rate = 30 + 15 * 2 * pi * 0.3 * std::cos(2 * pi * 0.3 * t); // deg/s
+    double pitch = 4 * std::sin(2 * pi * 0.5 * t);
+    double roll = 3 * std::sin(2 * pi * 0.7 * t);
+    double h = heading * pi / 180;
+    auto put16 = [&](uint8_t reg, double v) {
+        int16_t x = (int16_t)std::lround(v);
+        regs_[reg] = (uint8_t)(x >> 8);
+        regs_[reg + 1] = (uint8_t)x;
+    };
+    uint16_t tenths = (uint16_t)(std::lround(heading * 10) % 3600);
+    regs_[0x01] = (uint8_t)(tenths * 256 / 3600);
+    regs_[0x02] = (uint8_t)(tenths >> 8);
+    regs_[0x03] = (uint8_t)tenths;
+    regs_[0x04] = (uint8_t)(int8_t)std::lround(pitch);
+    regs_[0x05] = (uint8_t)(int8_t)std::lround(roll);
+    // BNO055 raw units: 16 LSB/uT, 100 LSB per m/s^2, 16 LSB per deg/s
+    put16(0x06, 16 * 40 * std::cos(h) + 3 * noise.next());
+    put16(0x08, -16 * 40 * std::sin(h) + 3 * noise.next());
+    put16(0x0A, -16 * 25 + 3 * noise.next());
+    put16(0x0C, 981 * std::sin(pitch * pi / 180) + 5 * noise.next());
+    put16(0x0E, 981 * std::sin(roll * pi / 180) + 5 * noise.next());
+    put16(0x10, 981 * std::cos(pitch * pi / 180) + 5 * noise.next());
+    put16(0x12, 16 * 4 * 2 * pi * 0.5 * std::cos(2 * pi * 0.5 * t));
+    put16(0x14, 16 * 3 * 2 * pi * 0.7 * std::cos(2 * pi * 0.7 * t));
+    put16(0x16, 16 * rate);
+    put16(0x18, 28);
+    put16(0x1A, 16 * heading);
+    put16(0x1C, pitch);
+}
+
+void SimCmps12::write(uint64_t now_us, const uint8_t *src, size_t len)
+{
+    (void)now_us, (void)src, (void)len; // commands (calibration, ...) are ignored
+}
+
+void SimCmps12::read(uint64_t now_us, uint8_t *dst, size_t len)
+{
+    update(now_us);
+    for (size_t i = 0; i < len; i++)
+        dst[i] = regs_[(reg_ + i) & 0x1F];
+}
@@ -0,0 +1,163 @@
+// Simulated I2C bus for the host tools: an i2c_engine_t backend that charges
+// each transaction its wire time on the virtual clock of tools/host, and
+// register-level models of the four sensors on the payload's bus.
+//
+// Wire time follows the I2C specification for the bus rate's mode (Sm up to
+// 100 kHz, Fm up to 400 kHz, Fm+ up to 1 MHz): START hold, 9 clocks per byte
+// (8 data + ACK/NACK), repeated START setup + hold, STOP setup and the bus
+// free time before the next START. A model may add clock stretching.
+// Changing the clock between transactions costs SIM_HZ_SWITCH_NS, about what
+// i2c_set_baudrate takes on the Pico. A device clocked above its rating does
+// not acknowledge its address (real parts may also return corrupt data).
+//
+// The models keep their state on the virtual clock and update it lazily when
+// they are accessed: conversions take their datasheet time, data ready flags
+// set and clear as on the device, and the data drifts plausibly.
+
+#ifndef TOOLS_I2C_SIM_H
+#define TOOLS_I2C_SIM_H
+
+#include "i2c_engine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SimDeviceStats {
+    uint32_t txns = 0;
+    uint64_t bytes = 0;   // written + read, address bytes not counted
+    uint64_t bus_ns = 0;  // time the device's transactions held the bus
+    uint32_t overspeed = 0; // transactions above the device's rated clock, NACKed
+    uint32_t hz = 0;        // clock of its last transaction
+};
+
+#define SIM_HZ_SWITCH_NS 3000
+
+// a device at one address: the first written byte selects a register,
+// further written bytes and read bytes auto-increment from there
+class SimDevice {
+public:
+    SimDevice(const char *name, uint8_t addr, uint32_t max_hz)
+        : name(name), addr(addr), max_hz(max_hz) {}
+    virtual ~SimDevice() = default;
+
+    const char *name;
+    uint8_t addr;
+    uint32_t max_hz; // fastest SCL in the datasheet
+    SimDeviceStats stats;
+
+    void select(uint8_t reg) { reg_ = reg; }
+    virtual void write(uint64_t now_us, const uint8_t *src, size_t len) = 0;
+    virtual void read(uint64_t now_us, uint8_t *dst, size_t len) = 0;
+    // extra SCL low time the device holds per byte read, in ns
+    virtual uint32_t stretch_ns() const { return 0; }
+
+protected:
+    uint8_t reg_ = 0;
+};
+
+class SimBus {
+public:
+    explicit SimBus(uint32_t hz);
+
+    i2c_engine_t eng;
+
+    void attach(SimDevice *dev) { devices_.push_back(dev); }
+    SimDevice *find(uint8_t addr) const;
+    const std::vector<SimDevice *> &devices() const { return devices_; }
+    uint32_t hz() const { return hz_; }
+    // wire time of txn addressed to dev (nullptr: nobody answers the address)
+    uint64_t wire_ns(const i2c_txn_t *txn, const SimDevice *dev) const;
+    void reset_stats();
+
+private:
+    friend void sim_bus_start(void *ctx, i2c_txn_t *txn);
+    friend void sim_bus_set_hz(void *ctx, uint32_t hz);
+    uint32_t hz_;
+    uint64_t carry_ns_ = 0; // sub-microsecond remainder of the wire times
+    std::vector<SimDevice *> devices_;
+};
+
+// BMP581 barometer, 0x47: normal, forced and standby modes at the ODR_CONFIG
+// rate, POR and DRDY in INT_STATUS (cleared by reading it), OSR_EFF
+class SimBmp581 : public SimDevice {
+public:
+    SimBmp581();
+    void write(uint64_t now_us, const uint8_t *src, size_t len) override;
+    void read(uint64_t now_us, uint8_t *dst, size_t len) override;
+
+private:
+    void update(uint64_t now_us);
+    uint64_t measurement_us() const;
+    uint8_t regs_[128] = {};
+    uint64_t next_sample_us_ = 0;
+    bool por_ = true;
+};
+
+// VEML6075 UV sensor, 0x10: 16-bit registers, low byte first. Active force
+// mode: UV_TRIG starts one integration of UV_IT, and stays set until the
+// results are in
+class SimVeml6075 : public SimDevice {
+public:
+    SimVeml6075();
+    void write(uint64_t now_us, const uint8_t *src, size_t len) override;
+    void read(uint64_t now_us, uint8_t *dst, size_t len) override;
+
+private:
+    void update(uint64_t now_us);
+    uint16_t regs_[16] = {};
+    uint64_t done_us_ = 0; // end of the running integration
+    bool integrating_ = false;
+    bool high_ = false;
+};
+
+// TMP117 thermometer, 0x48: 16-bit registers, high byte first. Continuous
+// conversion at the CONV/AVG cycle; Data_Ready sets at the end of each and
+// clears when CONFIGURATION or TEMP_RESULT is read
+class SimTmp117 : public SimDevice {
+public:
+    SimTmp117();
+    void write(uint64_t now_us, const uint8_t *src, size_t len) override;
+    void read(uint64_t now_us, uint8_t *dst, size_t len) override;
+
+private:
+    void update(uint64_t now_us);
+    uint64_t cycle_us() const;
+    uint16_t regs_[16] = {};
+    uint64_t next_conv_us_ = 0;
+    uint8_t pending_[2] = {};
+    size_t npending_ = 0;
+};
+
+// CMPS12 compass, 0x60: registers 0x00-0x1E refreshed by its fusion at
+// 100 Hz. The payload turns at 30 deg/s and twists +-15 deg at 0.3 Hz while
+// swinging a few degrees in pitch and roll
+class SimCmps12 : public SimDevice {
+public:
+    SimCmps12();
+    void write(uint64_t now_us, const uint8_t *src, size_t len) override;
+    void read(uint64_t now_us, uint8_t *dst, size_t len) override;
+
+private:
+    void update(uint64_t now_us);
+    uint8_t regs_[32] = {};
+    uint64_t next_update_us_ = 0;
+};
+
+// the payload's sensors, all on one bus
+struct SimPayload {
+    SimBmp581 bmp581;
+    SimVeml6075 veml6075;
+    SimTmp117 tmp117;
+    SimCmps12 cmps12;
+
+    void attach_to(SimBus &bus)
+    {
+        bus.attach(&bmp581);
+        bus.attach(&veml6075);
+        bus.attach(&tmp117);
+        bus.attach(&cmps12);
+    }
+};
+
+#endif
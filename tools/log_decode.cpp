@@ -0,0 +1,538 @@
+// Converts a binary sensor log (see log_format.h) to CSV.
+//
+//   log_decode log_0001.bin [out.csv] [--raw] [--align <period_ms>]
+//
+// Everything needed to decode a record comes from the file header, so files
+// written by any firmware build up to this LOG_FORMAT_VERSION decode here.
+// --raw prints the stored integers instead of scaled physical values.
+// --align resamples every channel onto one grid of period_ms, using each
+// channel's acquisition timestamp (see ACQUISITION TIMESTAMPS in
+// log_format.h) and linear interpolation between its samples. Only the span
+// covered by every channel is written, except for channels sampled far less
+// often than the rest, such as the spin summaries of a whole analysis window
+// (@spin, one per ~12.8 s): those hold their last value and are left empty
+// before their first sample, as are channels without any sample.
+
+#include "crc32.h"
+#include "log_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string field(const char *s, size_t n)
+{
+    return std::string(s, strnlen(s, n));
+}
+
+size_t type_size(uint8_t type)
+{
+    switch (type) {
+    case log_type_u8:
+    case log_type_i8:
+        return 1;
+    case log_type_u16:
+    case log_type_i16:
+        return 2;
+    case log_type_u32:
+    case log_type_i32:
+    case log_type_f32:
+        return 4;
+    case log_type_u64:
+    case log_type_i64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+template <typename T> T load(const uint8_t *p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+// writes one channel of a record, either raw or scaled
+void print_value(std::ostream &out, const log_channel_t &ch, const uint8_t *rec, bool raw)
+{
+    const uint8_t *p = rec + ch.offset;
+    double v = 0;
+    bool integral = true;
+    switch (ch.type) {
+    case log_type_u8: v = load<uint8_t>(p); break;
+    case log_type_i8: v = load<int8_t>(p); break;
+    case log_type_u16: v = load<uint16_t>(p); break;
+    case log_type_i16: v = load<int16_t>(p); break;
+    case log_type_u32: v = load<uint32_t>(p); break;
+    case log_type_i32: v = load<int32_t>(p); break;
+    case log_type_u64:
+        if (raw || (ch.frac_bits == 0 && ch.exp10 >= 0)) {
+            out << load<uint64_t>(p);
+            return;
+        }
+        v = static_cast<double>(load<uint64_t>(p));
+        break;
+    case log_type_i64:
+        if (raw || (ch.frac_bits == 0 && ch.exp10 >= 0)) {
+            out << load<int64_t>(p);
+            return;
+        }
+        v = static_cast<double>(load<int64_t>(p));
+        break;
+    case log_type_f32:
+        v = load<float>(p);
+        integral = false;
+        break;
+    }
+    char buf[48];
+    if (!raw) {
+        v = std::ldexp(v, -ch.frac_bits) * std::pow(10.0, ch.exp10);
+        if (integral) {
+            // enough decimals to print a binary/decimal fixed point value exactly
+            int decimals = ch.frac_bits + (ch.exp10 < 0 ? -ch.exp10 : 0);
+            std::snprintf(buf, sizeof buf, "%.*f", decimals, v);
+            out << buf;
+            return;
+        }
+    }
+    if (integral)
+        std::snprintf(buf, sizeof buf, "%.0f", v);
+    else
+        std::snprintf(buf, sizeof buf, "%.9g", v);
+    out << buf;
+}
+
+// a channel's physical value as a double
+double scaled_value(const log_channel_t &ch, const uint8_t *rec)
+{
+    const uint8_t *p = rec + ch.offset;
+    double v = 0;
+    switch (ch.type) {
+    case log_type_u8: v = load<uint8_t>(p); break;
+    case log_type_i8: v = load<int8_t>(p); break;
+    case log_type_u16: v = load<uint16_t>(p); break;
+    case log_type_i16: v = load<int16_t>(p); break;
+    case log_type_u32: v = load<uint32_t>(p); break;
+    case log_type_i32: v = load<int32_t>(p); break;
+    case log_type_u64: v = static_cast<double>(load<uint64_t>(p)); break;
+    case log_type_i64: v = static_cast<double>(load<int64_t>(p)); break;
+    case log_type_f32: return load<float>(p);
+    }
+    return std::ldexp(v, -ch.frac_bits) * std::pow(10.0, ch.exp10);
+}
+
+// The records of a file, up to the end of the data.
+// Files in blocks (see BLOCKS in log_format.h) end at the first block that is
+// not committed: unwritten, torn by a power loss or left by an older file.
+// Files of bare records are preallocated too (see logging.c) and cut to
+// length when closed; after a power loss one keeps its full size, and past
+// the last record lies whatever the clusters held: erased sectors (all 0x00
+// or 0xFF) or the records of an older file, whose time runs backwards.
+class RecordReader {
+public:
+    RecordReader(std::istream &in, const log_file_header_t &h)
+        : in_(in), record_bytes_(h.record_bytes), block_(h.block_bytes), rec_(h.record_bytes)
+    {
+        for (unsigned i = 0; i < h.num_channels; i++)
+            if (field(h.channels[i].name, sizeof h.channels[i].name) == "time")
+                time_ = &h.channels[i];
+        if (!block_.empty())
+            in_.ignore(LOG_BLOCKS_START(h.header_bytes, h.block_bytes) - h.header_bytes);
+    }
+
+    // the next record, or nullptr at the end of the data
+    const uint8_t *next()
+    {
+        if (!block_.empty()) {
+            while (index_ == in_block_)
+                if (!read_block())
+                    return nullptr;
+            return block_.data() + sizeof(log_block_head_t) + index_++ * record_bytes_;
+        }
+        if (!in_.read(reinterpret_cast<char *>(rec_.data()), rec_.size()))
+            return nullptr;
+        bool erased = (rec_[0] == 0 || rec_[0] == 0xFF) &&
+                      std::all_of(rec_.begin(), rec_.end(), [this](uint8_t b) { return b == rec_[0]; });
+        double t = time_ ? scaled_value(*time_, rec_.data()) : 0;
+        if (erased || t < last_time_) {
+            end_ = "unwritten space (file cut short, e.g. by a power loss)";
+            return nullptr;
+        }
+        last_time_ = t;
+        return rec_.data();
+    }
+
+    // what made next() stop, on stderr
+    void report_end() const
+    {
+        if (!block_.empty()) {
+            std::cerr << blocks_ << " blocks";
+            if (resets_)
+                std::cerr << ", resumed after " << resets_ << " resets (time restarts at each)";
+            std::cerr << "\n";
+        }
+        if (end_)
+            std::cerr << "stopped at " << end_ << "\n";
+        else if (in_.gcount() != 0)
+            std::cerr << "ignored " << in_.gcount() << " trailing bytes (torn record)\n";
+    }
+
+private:
+    // reads and checks the next block; false at the end of the data
+    bool read_block()
+    {
+        log_block_head_t head;
+        log_block_tail_t tail;
+        size_t max_records = (block_.size() - sizeof head - sizeof tail) / record_bytes_;
+        if (!in_.read(reinterpret_cast<char *>(block_.data()), block_.size()))
+            return false;
+        std::memcpy(&head, block_.data(), sizeof head);
+        std::memcpy(&tail, block_.data() + block_.size() - sizeof tail, sizeof tail);
+        bool ours = head.magic == LOG_BLOCK_MAGIC && head.seq == blocks_ &&
+                    (blocks_ == 0 || head.file_id == file_id_);
+        if (!ours) {
+            end_ = "the first unwritten block";
+            return false;
+        }
+        if (tail.magic != LOG_COMMIT_MAGIC || head.records > max_records ||
+            crc32(0, block_.data(), block_.size() - sizeof tail) != tail.crc) {
+            end_ = "a torn block (no commit marker or a bad CRC), e.g. after a power loss";
+            return false;
+        }
+        if (blocks_ != 0 && head.boot != boot_)
+            resets_++;
+        file_id_ = head.file_id;
+        boot_ = head.boot;
+        blocks_++;
+        in_block_ = head.records;
+        index_ = 0;
+        return true;
+    }
+
+    std::istream &in_;
+    size_t record_bytes_;
+    std::vector<uint8_t> block_; // empty: bare records
+    std::vector<uint8_t> rec_;
+    const log_channel_t *time_ = nullptr;
+    double last_time_ = 0;
+    size_t in_block_ = 0;
+    size_t index_ = 0;
+    uint32_t blocks_ = 0;
+    uint32_t file_id_ = 0;
+    uint16_t boot_ = 0;
+    unsigned resets_ = 0;
+    const char *end_ = nullptr;
+};
+
+bool is_time_channel(const log_channel_t &ch)
+{
+    return ch.name[0] == '@' && ch.type == log_type_u64 &&
+           field(ch.unit, sizeof ch.unit) == "us";
+}
+
+struct sample {
+    uint64_t t_us;
+    double v;
+};
+
+// a channel whose samples are this many times further apart than those of the
+// fastest channel is a summary of a window; it holds its value instead. The
+// spin analysis reports once per SPIN_WINDOW (spin.h, 256) compass reads: every
+// 12.8 s at 20 Hz, 5.1 s with SPIN_CAPTURE, so 128 or 51 record intervals of
+// 100 ms. The slowest sensor, the UV at 1 Hz, is 10 apart. 32 leaves a factor
+// of 3 or more to either side
+constexpr double HELD_INTERVAL_RATIO = 32;
+
+// one data channel's samples, each at its own acquisition time
+struct series {
+    unsigned channel;
+    std::vector<sample> samples;
+    bool held = false; // not interpolated and not limiting the span
+
+    double interval_us() const
+    {
+        if (samples.size() < 2)
+            return INFINITY;
+        return double(samples.back().t_us - samples.front().t_us) / double(samples.size() - 1);
+    }
+
+    // the value of the newest sample at or before t_us; false before the first
+    bool held_at(uint64_t t_us, double *v) const
+    {
+        auto hi = std::upper_bound(samples.begin(), samples.end(), t_us,
+                                   [](uint64_t t, const sample &s) { return t < s.t_us; });
+        if (hi == samples.begin())
+            return false;
+        *v = (hi - 1)->v;
+        return true;
+    }
+
+    double at(uint64_t t_us) const
+    {
+        auto hi = std::lower_bound(samples.begin(), samples.end(), t_us,
+                                   [](const sample &s, uint64_t t) { return s.t_us < t; });
+        if (hi == samples.begin())
+            return hi->v;
+        if (hi == samples.end())
+            return samples.back().v;
+        auto lo = hi - 1;
+        double f = double(t_us - lo->t_us) / double(hi->t_us - lo->t_us);
+        return lo->v + f * (hi->v - lo->v);
+    }
+};
+
+// index of the "@<prefix>" channel with the longest prefix of ch's name, or -1
+int time_channel_of(const log_file_header_t &h, const log_channel_t &ch)
+{
+    std::string name = field(ch.name, sizeof ch.name);
+    int best = -1;
+    size_t best_len = 0;
+    for (unsigned i = 0; i < h.num_channels; i++) {
+        if (!is_time_channel(h.channels[i]))
+            continue;
+        std::string prefix = field(h.channels[i].name, sizeof h.channels[i].name).substr(1);
+        if (prefix.size() > best_len && name.compare(0, prefix.size(), prefix) == 0) {
+            best = int(i);
+            best_len = prefix.size();
+        }
+    }
+    return best;
+}
+
+// reads every record and writes the data channels resampled every period_us
+int write_aligned(std::istream &in, std::ostream &out, const log_file_header_t &h,
+                  uint64_t period_us)
+{
+    int record_time = -1; // "time" in ms, for channels without "@" timestamps
+    for (unsigned i = 0; i < h.num_channels; i++)
+        if (field(h.channels[i].name, sizeof h.channels[i].name) == "time")
+            record_time = int(i);
+
+    std::vector<series> all;
+    std::vector<int> time_of;
+    for (unsigned i = 0; i < h.num_channels; i++) {
+        const log_channel_t &ch = h.channels[i];
+        if (int(i) == record_time || is_time_channel(ch))
+            continue;
+        int t = time_channel_of(h, ch);
+        if (t < 0 && record_time < 0) {
+            std::cerr << "no timestamp for channel " << field(ch.name, sizeof ch.name)
+                      << ", skipped\n";
+            continue;
+        }
+        all.push_back({i, {}, false});
+        time_of.push_back(t);
+    }
+
+    RecordReader reader(in, h);
+    size_t records = 0;
+    while (const uint8_t *rec = reader.next()) {
+        for (size_t k = 0; k < all.size(); k++) {
+            uint64_t t_us = time_of[k] >= 0
+                                ? load<uint64_t>(rec + h.channels[time_of[k]].offset)
+                                : uint64_t(scaled_value(h.channels[record_time], rec) * 1000);
+            std::vector<sample> &s = all[k].samples;
+            // 0: never read yet; a repeated time: the same reading held over
+            if (t_us == 0 || (!s.empty() && t_us <= s.back().t_us))
+                continue;
+            s.push_back({t_us, scaled_value(h.channels[all[k].channel], rec)});
+        }
+        records++;
+    }
+    reader.report_end();
+
+    double fastest = INFINITY;
+    for (const series &s : all)
+        fastest = std::min(fastest, s.interval_us());
+    if (fastest == INFINITY) {
+        std::cerr << "no channel has two samples to align\n";
+        return 1;
+    }
+    uint64_t first = 0;
+    uint64_t last = UINT64_MAX;
+    for (series &s : all) {
+        std::string name = field(h.channels[s.channel].name, LOG_CHANNEL_NAME_LEN);
+        if (s.samples.empty()) {
+            std::cerr << "channel " << name << " has no samples, left empty\n";
+            s.held = true;
+            continue;
+        }
+        if (s.interval_us() > HELD_INTERVAL_RATIO * fastest) {
+            std::cerr << "channel " << name << " has " << s.samples.size()
+                      << " sample(s), held between them\n";
+            s.held = true;
+            continue;
+        }
+        first = std::max(first, s.samples.front().t_us);
+        last = std::min(last, s.samples.back().t_us);
+    }
+
+    out << "time_us";
+    for (const series &s : all) {
+        const log_channel_t &ch = h.channels[s.channel];
+        std::string unit = field(ch.unit, sizeof ch.unit);
+        out << "," << field(ch.name, sizeof ch.name);
+        if (!unit.empty())
+            out << "_" << unit;
+    }
+    out << "\n";
+
+    size_t rows = 0;
+    char buf[32];
+    // start on a whole multiple of the period so files line up with each other
+    for (uint64_t t = (first + period_us - 1) / period_us * period_us; t <= last;
+         t += period_us) {
+        out << t;
+        for (const series &s : all) {
+            double v;
+            if (!s.held)
+                v = s.at(t);
+            else if (!s.held_at(t, &v)) {
+                out << ",";
+                continue;
+            }
+            std::snprintf(buf, sizeof buf, ",%.9g", v);
+            out << buf;
+        }
+        out << "\n";
+        rows++;
+    }
+    std::cerr << records << " records, " << rows << " aligned rows\n";
+    return 0;
+}
+
+bool check_header(const log_file_header_t &h)
+{
+    if (std::memcmp(h.magic, LOG_FORMAT_MAGIC, LOG_FORMAT_MAGIC_LEN) != 0) {
+        std::cerr << "not a sensor log (bad magic)\n";
+        return false;
+    }
+    // version 1 differs only in having no block_bytes, 0 there
+    if (h.version < 1 || h.version > LOG_FORMAT_VERSION) {
+        std::cerr << "unsupported log version " << h.version << " (expected 1 to "
+                  << LOG_FORMAT_VERSION << ")\n";
+        return false;
+    }
+    if (h.num_channels > LOG_MAX_CHANNELS || h.record_bytes == 0 ||
+        (h.block_bytes != 0 && h.block_bytes < sizeof(log_block_head_t) +
+                                                   sizeof(log_block_tail_t) + h.record_bytes)) {
+        std::cerr << "corrupt log header\n";
+        return false;
+    }
+    for (unsigned i = 0; i < h.num_channels; i++) {
+        const log_channel_t &ch = h.channels[i];
+        size_t n = type_size(ch.type);
+        if (n == 0 || ch.offset + n > h.record_bytes) {
+            std::cerr << "channel " << i << " does not fit the record\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *in_path = nullptr;
+    const char *out_path = nullptr;
+    bool raw = false;
+    uint64_t align_us = 0;
+    bool bad_arg = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--raw") == 0) {
+            raw = true;
+        } else if (std::strcmp(argv[i], "--align") == 0) {
+            // at least 1 us; "abc" or "-5" is a typo, not a request for the
+            // unaligned output
+            char *end = nullptr;
+            double ms = i + 1 < argc ? std::strtod(argv[++i], &end) : 0;
+            if (!end || end == argv[i] || *end || !(ms * 1000 >= 1) || ms * 1000 > 1e15)
+                bad_arg = true;
+            else
+                align_us = uint64_t(ms * 1000);
+        } else if (!in_path) {
+            in_path = argv[i];
+        } else if (!out_path) {
+            out_path = argv[i];
+        }
+    }
+    if (!in_path || bad_arg) {
+        std::cerr << "usage: " << argv[0]
+                  << " <log.bin> [out.csv] [--raw] [--align <period_ms>]\n";
+        return 2;
+    }
+
+    std::ifstream in(in_path, std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << in_path << "\n";
+        return 1;
+    }
+    // the fixed part first: header_bytes says how many channel slots the
+    // writer had, which may be fewer than LOG_MAX_CHANNELS today
+    log_file_header_t header{};
+    const size_t fixed = offsetof(log_file_header_t, channels);
+    if (!in.read(reinterpret_cast<char *>(&header), fixed)) {
+        std::cerr << "file too short for a log header\n";
+        return 1;
+    }
+    if (header.header_bytes < fixed || header.header_bytes > sizeof header ||
+        (header.header_bytes - fixed) % sizeof(log_channel_t) != 0 ||
+        !in.read(reinterpret_cast<char *>(&header) + fixed, header.header_bytes - fixed)) {
+        std::cerr << "corrupt log header\n";
+        return 1;
+    }
+    if (!check_header(header))
+        return 1;
+
+    std::ofstream out_file;
+    if (out_path) {
+        out_file.open(out_path);
+        if (!out_file) {
+            std::cerr << "cannot create " << out_path << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = out_path ? out_file : std::cout;
+
+    out << "# bmp581 osr_t=" << (1 << header.bmp581_osr_t)
+        << "x osr_p=" << (1 << header.bmp581_osr_p)
+        << "x, veml6075 it=" << header.veml6075_it_ms
+        << "ms hd=" << int(header.veml6075_hd) << "\n";
+    if (align_us)
+        return write_aligned(in, out, header, align_us);
+    for (unsigned i = 0; i < header.num_channels; i++) {
+        const log_channel_t &ch = header.channels[i];
+        std::string unit = field(ch.unit, sizeof ch.unit);
+        out << (i ? "," : "") << field(ch.name, sizeof ch.name);
+        if (!unit.empty())
+            out << "_" << unit;
+    }
+    out << "\n";
+
+    RecordReader reader(in, header);
+    size_t records = 0;
+    while (const uint8_t *rec = reader.next()) {
+        for (unsigned i = 0; i < header.num_channels; i++) {
+            if (i)
+                out << ",";
+            print_value(out, header.channels[i], rec, raw);
+        }
+        out << "\n";
+        records++;
+    }
+    reader.report_end();
+    std::cerr << records << " records\n";
+    return 0;
+}
@@ -0,0 +1,343 @@
+// Power-cut checks for the SD logger (../logging.c), run against a FatFs
+// stand-in that keeps the card in a host directory (host/ff_host.c).
+//
+//   log_recovery [card_dir=log_recovery.card]
+//
+// Every case runs the logger over several boots. Each boot is a child process,
+// so the stand-in can cut the power in the middle of any write: the write
+// lands half done and the process exits on the spot. The last boot of a case
+// shuts down cleanly. Then every file on the card is read back and checked:
+// - resume: after a cut, the next boot appends to the same file, starting at
+//     the first block that was not committed (the binary search in
+//     log_resume), and only starts a new file if that one was full
+// - torn block: the block the cut left half written is found as such and
+//     written over, so the file holds committed blocks only
+// - truncate on close: a closed file ends right after its last block, and a
+//     boot after a clean shutdown starts a new file instead of resuming it
+// - records: each boot's records are in order, and no record is lost that
+//     was committed (logging_flush returned) before the cut
+// One case cuts at every write of a run that spans three files. The exit
+// status is 1 if any check fails.
+
+extern "C" {
+#include "crc32.h"
+#include "ff.h"
+#include "log_format.h"
+#include "logging.h"
+#include "pico/time.h"
+}
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// small files, so a few hundred records rotate through several of them
+constexpr uint32_t ROTATE_BYTES = 32 * 1024;
+constexpr int32_t BOOT_STRIDE = 1000000; // record value: boot * BOOT_STRIDE + index
+constexpr int MAX_BOOTS = 8;
+constexpr size_t BLOCKS_START =
+    LOG_BLOCKS_START(sizeof(log_file_header_t), LOG_BLOCK_BYTES);
+constexpr uint32_t FILE_BLOCKS = (ROTATE_BYTES - BLOCKS_START) / LOG_BLOCK_BYTES;
+
+struct Boot {
+    uint32_t records;
+    long cut_after_writes; // -1: shuts down cleanly
+};
+
+// written by the boots, read by the checks
+struct Shared {
+    uint32_t committed[MAX_BOOTS]; // records on the card when the last flush returned
+    long writes;                   // f_write calls of the last boot
+};
+
+// one boot of the logger: records go in batches, each committed as core1
+// does with a batch from core0
+int run_boot(const std::string &dir, int boot, const Boot &b, Shared *shared)
+{
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        alarm(10); // a boot that hangs fails the case
+        // the logger's own messages are not part of the report
+        if (!std::freopen("/dev/null", "w", stdout))
+            _exit(1);
+        ff_host_mount_dir(dir.c_str());
+        ff_host_cut_after(b.cut_after_writes);
+        log_config_t config = LOG_CONFIG_DEFAULT;
+        config.rotate_bytes = ROTATE_BYTES;
+        config.rotate_ms = 0;
+        if (!logging_init(&config))
+            _exit(1);
+        for (uint32_t i = 0; i < b.records; i++) {
+            log_t log = {};
+            host_advance_us(100000);
+            log.time_ms = to_ms_since_boot(get_absolute_time());
+            log.press_data = boot * BOOT_STRIDE + int32_t(i);
+            write_result(&log);
+            if (i % LOG_BATCH_SIZE == LOG_BATCH_SIZE - 1 || i + 1 == b.records) {
+                if (!logging_flush(true))
+                    _exit(1);
+                shared->committed[boot] = i + 1;
+            }
+        }
+        logging_shutdown();
+        shared->writes = ff_host_writes();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// what is on the card, read back as log_decode would
+struct CardFile {
+    std::string name;
+    bool header_ok = false;
+    uint64_t size = 0;
+    uint32_t blocks = 0;      // committed blocks, from the first
+    bool torn_next = false;   // the block after them was partly written
+    std::vector<int32_t> records;
+    std::vector<uint32_t> record_block;
+};
+
+bool block_ok(const uint8_t *p, uint32_t seq, uint32_t *file_id, log_block_head_t *o_head)
+{
+    log_block_tail_t tail;
+    std::memcpy(o_head, p, sizeof *o_head);
+    std::memcpy(&tail, p + LOG_BLOCK_BYTES - sizeof tail, sizeof tail);
+    if (o_head->magic != LOG_BLOCK_MAGIC || tail.magic != LOG_COMMIT_MAGIC ||
+        o_head->seq != seq || o_head->records > LOG_BLOCK_RECORDS ||
+        crc32(0, p, LOG_BLOCK_BYTES - sizeof tail) != tail.crc)
+        return false;
+    if (seq == 0)
+        *file_id = o_head->file_id;
+    return o_head->file_id == *file_id;
+}
+
+std::vector<CardFile> read_card(const std::string &dir)
+{
+    std::vector<CardFile> files;
+    for (unsigned n = 1;; n++) {
+        char name[32];
+        std::snprintf(name, sizeof name, "log_%04u.bin", n);
+        std::ifstream in(dir + "/" + name, std::ios::binary);
+        if (!in)
+            break;
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)),
+                                  std::istreambuf_iterator<char>());
+        CardFile f;
+        f.name = name;
+        f.size = data.size();
+        log_file_header_t h;
+        f.header_ok = data.size() >= sizeof h &&
+                      std::memcmp(data.data(), LOG_FORMAT_MAGIC, LOG_FORMAT_MAGIC_LEN) == 0;
+        uint32_t file_id = 0;
+        size_t ofs = BLOCKS_START;
+        for (; f.header_ok && ofs + LOG_BLOCK_BYTES <= data.size(); ofs += LOG_BLOCK_BYTES) {
+            log_block_head_t head;
+            if (!block_ok(data.data() + ofs, f.blocks, &file_id, &head))
+                break;
+            for (unsigned k = 0; k < head.records; k++) {
+                log_record_t rec;
+                std::memcpy(&rec, data.data() + ofs + sizeof head + k * sizeof rec, sizeof rec);
+                f.records.push_back(rec.press);
+                f.record_block.push_back(f.blocks);
+            }
+            f.blocks++;
+        }
+        for (size_t k = 0; ofs + k < data.size() && k < LOG_BLOCK_BYTES; k++)
+            if (data[ofs + k] != FF_HOST_STALE_BYTE)
+                f.torn_next = true;
+        files.push_back(f);
+    }
+    return files;
+}
+
+class Case {
+public:
+    Case(const char *name, const std::string &dir) : name_(name), dir_(dir) {}
+
+    // false if the check failed; the reason is printed
+    bool run(const std::vector<Boot> &boots, Shared *shared)
+    {
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+        std::memset(shared, 0, sizeof *shared);
+        bool was_cut = false;
+        for (size_t b = 0; b < boots.size(); b++) {
+            std::vector<CardFile> before = read_card(dir_);
+            int rc = run_boot(dir_, int(b), boots[b], shared);
+            // a cut after the run's last write never happens
+            if (rc != 0 && !(rc == FF_HOST_CUT_EXIT && boots[b].cut_after_writes >= 0))
+                return fail("boot " + std::to_string(b) + " exited with " + std::to_string(rc));
+            if (b > 0 && !check_next_boot(before, b, was_cut))
+                return false;
+            was_cut = rc == FF_HOST_CUT_EXIT;
+            if (was_cut && !check_torn(b))
+                return false;
+        }
+        return check_final(boots, shared);
+    }
+
+    unsigned torn() const { return torn_; }
+    unsigned resumed() const { return resumed_; }
+
+private:
+    bool fail(const std::string &why)
+    {
+        std::printf("%s: FAILED, %s\n", name_, why.c_str());
+        return false;
+    }
+
+    // the newest file was open when the power went: it is not cut to length,
+    // and ends its committed blocks at the one the cut tore
+    bool check_torn(size_t boot)
+    {
+        std::vector<CardFile> files = read_card(dir_);
+        if (files.empty())
+            return true; // cut before the first file got anything
+        const CardFile &f = files.back();
+        if (f.size == BLOCKS_START + uint64_t(f.blocks) * LOG_BLOCK_BYTES)
+            return fail(f.name + " looks closed after the cut of boot " + std::to_string(boot));
+        if (f.torn_next)
+            torn_++;
+        return true;
+    }
+
+    // after a cut, boot b appended to the file that was open, right after its
+    // last committed block; after a clean shutdown it left that file alone
+    bool check_next_boot(const std::vector<CardFile> &before, size_t b, bool was_cut)
+    {
+        std::vector<CardFile> files = read_card(dir_);
+        if (before.empty() || !before.back().header_ok)
+            return true; // nothing to resume
+        const CardFile &was = before.back();
+        const CardFile &now = files[before.size() - 1];
+        if (!was_cut) {
+            if (now.size != was.size || files.size() == before.size())
+                return fail(now.name + " was reopened after a clean shutdown");
+            return true;
+        }
+        if (was.blocks >= FILE_BLOCKS)
+            return true; // full: the next boot had to start a new file
+        if (now.blocks <= was.blocks ||
+            !std::equal(was.records.begin(), was.records.end(), now.records.begin()))
+            return fail("boot " + std::to_string(b) + " did not resume " + was.name +
+                        " after block " + std::to_string(was.blocks));
+        // the first record of the resumed boot sits in the block the cut tore
+        auto first = std::find_if(now.records.begin(), now.records.end(), [b](int32_t v) {
+            return v / BOOT_STRIDE >= int32_t(b);
+        });
+        if (first == now.records.end() ||
+            now.record_block[size_t(first - now.records.begin())] != was.blocks)
+            return fail("boot " + std::to_string(b) + " did not resume at block " +
+                        std::to_string(was.blocks) + " of " + was.name);
+        resumed_++;
+        return true;
+    }
+
+    bool check_final(const std::vector<Boot> &boots, const Shared *shared)
+    {
+        std::vector<CardFile> files = read_card(dir_);
+        std::vector<int32_t> all;
+        for (const CardFile &f : files) {
+            if (!f.header_ok) {
+                if (&f == &files.back())
+                    return fail(f.name + " has no header after a clean shutdown");
+                continue; // torn before its header was written; never resumed
+            }
+            if (f.size != BLOCKS_START + uint64_t(f.blocks) * LOG_BLOCK_BYTES)
+                return fail(f.name + " is " + std::to_string(f.size) + " bytes, not cut to its " +
+                            std::to_string(f.blocks) + " blocks on close");
+            all.insert(all.end(), f.records.begin(), f.records.end());
+        }
+        // per boot: 0, 1, 2, ... and at least the committed ones
+        size_t k = 0;
+        for (size_t b = 0; b < boots.size(); b++) {
+            uint32_t n = 0;
+            for (; k < all.size() && all[k] / BOOT_STRIDE == int32_t(b); k++, n++)
+                if (all[k] % BOOT_STRIDE != int32_t(n))
+                    return fail("boot " + std::to_string(b) + " record " + std::to_string(n) +
+                                " is out of order");
+            if (n < shared->committed[b] || n > boots[b].records)
+                return fail("boot " + std::to_string(b) + " has " + std::to_string(n) +
+                            " records on the card, " + std::to_string(shared->committed[b]) +
+                            " were committed");
+        }
+        if (k != all.size())
+            return fail("records of an unknown boot on the card");
+        return true;
+    }
+
+    const char *name_;
+    std::string dir_;
+    unsigned torn_ = 0;
+    unsigned resumed_ = 0;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string dir = argc > 1 ? argv[1] : "log_recovery.card";
+    auto *shared = static_cast<Shared *>(mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (shared == MAP_FAILED) {
+        std::perror("log_recovery: mmap");
+        return 1;
+    }
+    bool ok = true;
+
+    struct Named {
+        const char *name;
+        std::vector<Boot> boots;
+    };
+    const Named fixed[] = {
+        {"clean shutdown, next boot starts a new file", {{100, -1}, {100, -1}}},
+        {"cut mid-file, resumed", {{200, 3}, {100, -1}}},
+        {"cut twice in one file", {{200, 2}, {150, 2}, {100, -1}}},
+        {"cut before the first write", {{100, 0}, {100, -1}}},
+    };
+    for (const Named &c : fixed) {
+        Case run(c.name, dir);
+        if (run.run(c.boots, shared))
+            std::printf("%s: ok (%u torn blocks, %u resumed)\n", c.name, run.torn(),
+                        run.resumed());
+        else
+            ok = false;
+    }
+
+    // a run over three files, cut at each of its writes in turn
+    const uint32_t records = 2 * FILE_BLOCKS * LOG_BLOCK_RECORDS + 100;
+    Case probe("uncut", dir);
+    if (!probe.run({{records, -1}}, shared))
+        return 1;
+    long writes = shared->writes;
+    unsigned torn = 0;
+    unsigned resumed = 0;
+    unsigned failed = 0;
+    for (long w = 0; w < writes; w++) {
+        std::string name = "cut at write " + std::to_string(w);
+        Case run(name.c_str(), dir);
+        if (!run.run({{records, w}, {100, -1}}, shared))
+            failed++;
+        torn += run.torn();
+        resumed += run.resumed();
+    }
+    std::printf("cut at each of %ld writes over 3 files: %s (%u torn blocks, %u resumed)\n",
+                writes, failed ? "FAILED" : "ok", torn, resumed);
+    std::filesystem::remove_all(dir);
+    return ok && failed == 0 ? 0 : 1;
+}
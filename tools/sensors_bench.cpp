@@ -0,0 +1,151 @@
+// Throughput of the firmware's sensor loop at several I2C clocks, on the
+// simulated bus and sensors of i2c_sim.h.
+//
+//   sensors_bench [seconds=20] [cpu_us=0] [max_hz ...=100000 400000 1000000]
+//
+// For every clock limit the sensors are brought up with sensors_init, as on
+// the payload: each device is probed for the fastest clock it works at, up
+// to the limit. Both clock policies run: every device at its own clock, and
+// the whole bus at the slowest device's clock. The firmware's task table
+// (sensors.c) then runs for the given virtual time. Every task is wrapped to
+// attribute the bus traffic of each run to it, which gives:
+// - per task: transactions, bytes and bus time per run, i.e. the transaction
+//     pattern its driver issues for one sample
+// - the loop: one run of every task back to back. Its bus time, plus cpu_us
+//     of processing per loop (see pipeline_bench.c for the figure on the
+//     Pico), bounds the loop rate
+// - the current schedule: bus utilisation and overruns at the task periods
+// - per device: its clock and share of the bus
+// Conversion times (TMP117 cycle, VEML6075 integration, BMP581 ODR) limit how
+// often a sensor has new data; that is the schedule's concern, not the bus's.
+
+#include "i2c_sim.h"
+
+extern "C" {
+#include "i2c_engine.h"
+#include "logging.h"
+#include "pico/time.h"
+#include "scheduler.h"
+#include "sensors.h"
+}
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct TaskProbe {
+    sched_fn_t fn;
+    void *user;
+    i2c_engine_t *eng;
+    uint32_t runs = 0;
+    uint64_t txns = 0;
+    uint64_t bytes = 0;
+    uint64_t bus_us = 0;
+};
+
+void probe_task(void *user, uint64_t release_us)
+{
+    TaskProbe *p = static_cast<TaskProbe *>(user);
+    i2c_engine_stats_t before = p->eng->stats;
+    p->fn(p->user, release_us);
+    p->runs++;
+    p->txns += p->eng->stats.completed - before.completed;
+    p->bytes += p->eng->stats.bytes - before.bytes;
+    p->bus_us += p->eng->stats.bus_us - before.bus_us;
+}
+
+const char *mode_name(uint32_t hz)
+{
+    return hz <= 100000 ? "Sm" : hz <= 400000 ? "Fm" : "Fm+";
+}
+
+void run(FILE *out, uint32_t max_hz, bool per_device, double seconds, uint64_t cpu_us)
+{
+    SimBus bus(100000);
+    SimPayload payload;
+    payload.attach_to(bus);
+    sensors_init(&bus.eng, max_hz, per_device);
+
+    size_t num_tasks;
+    sched_task_t *tasks = sensors_tasks(&num_tasks);
+    std::vector<TaskProbe> probes(num_tasks);
+    for (size_t i = 0; i < num_tasks; i++) {
+        probes[i].fn = tasks[i].fn;
+        probes[i].user = tasks[i].user;
+        probes[i].eng = &bus.eng;
+        tasks[i].fn = probe_task;
+        tasks[i].user = &probes[i];
+    }
+
+    bus.reset_stats();
+    uint64_t start_us = time_us_64();
+    uint64_t end_us = start_us + (uint64_t)(seconds * 1e6);
+    sensors_start();
+    while (time_us_64() < end_us)
+        sched_run_once();
+    uint64_t elapsed_us = time_us_64() - start_us;
+
+    std::fprintf(out, "\nup to %u kHz (%s), %s\n", max_hz / 1000, mode_name(max_hz),
+                 per_device ? "clock per device" : "one clock for the bus");
+    std::fprintf(out, "%-10s %6s %8s %10s %11s %5s\n", "task", "runs", "txn/run",
+                 "bytes/run", "bus us/run", "over");
+    double loop_us = 0;
+    uint32_t overruns = 0;
+    for (size_t i = 0; i < num_tasks; i++) {
+        const TaskProbe &p = probes[i];
+        double n = p.runs ? p.runs : 1;
+        loop_us += p.bus_us / n;
+        overruns += tasks[i].stats.overruns;
+        std::fprintf(out, "%-10s %6u %8.1f %10.1f %11.1f %5u\n", tasks[i].name, p.runs,
+                     p.txns / n, p.bytes / n, p.bus_us / n, tasks[i].stats.overruns);
+        tasks[i].fn = p.fn; // sensors_init of the next run expects the originals
+        tasks[i].user = p.user;
+    }
+    std::fprintf(out, "loop: %.0f us on the bus + %llu us CPU -> %.0f loops/s\n", loop_us,
+                 (unsigned long long)cpu_us, 1e6 / (loop_us + cpu_us));
+    std::fprintf(out, "schedule: bus %.2f%% busy, %u clock switches, %u overruns in %.0f s\n",
+                 100.0 * bus.eng.stats.bus_us / elapsed_us, bus.eng.stats.hz_switches,
+                 overruns, elapsed_us / 1e6);
+    for (const SimDevice *d : bus.devices()) {
+        std::fprintf(out, "  %-9s %5u kHz %6.2f%% of the time, %u transactions", d->name,
+                     d->stats.hz / 1000, 100.0 * d->stats.bus_ns / 1000 / elapsed_us,
+                     d->stats.txns);
+        if (d->stats.overspeed)
+            std::fprintf(out, ", %u NACKed above its %u kHz rating", d->stats.overspeed,
+                         d->max_hz / 1000);
+        std::fprintf(out, "\n");
+    }
+}
+
+} // namespace
+
+// the records are not needed, only the bus traffic behind them
+extern "C" void log_submit(const log_t *log) { (void)log; }
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 20;
+    uint64_t cpu_us = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 0;
+    std::vector<uint32_t> rates;
+    for (int i = 3; i < argc; i++)
+        rates.push_back((uint32_t)std::strtoul(argv[i], nullptr, 0));
+    if (rates.empty())
+        rates = {100000, 400000, 1000000};
+
+    // the firmware's console output would bury the results
+    FILE *out = fdopen(dup(fileno(stdout)), "w");
+    if (out == nullptr || std::freopen("/dev/null", "w", stdout) == nullptr) {
+        std::fprintf(stderr, "sensors_bench: cannot redirect the console\n");
+        return 1;
+    }
+    std::fprintf(out, "%.0f virtual seconds per bus clock\n", seconds);
+    for (uint32_t hz : rates)
+        for (bool per_device : {true, false})
+            run(out, hz, per_device, seconds, cpu_us);
+    std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Runs the firmware's sensor drivers, scheduler tasks and log encoder
+// (../sensors.c and everything under it) natively, against the simulated
+// I2C bus and sensors of i2c_sim.h, and writes the records they produce to a
+// log file that log_decode reads.
+//
+//   sensors_host [seconds=30] [log=sensors_host.bin] [max_hz=1000000]
+//                [--stream <file|pty>]
+//
+// The Pico SDK is replaced by tools/host: a virtual clock, no-op GPIO and no
+// interrupts, so the drivers take their polling paths. Time is virtual; a
+// transaction holds the bus for its wire time at the clock sensors_init
+// probed for its device, at most max_hz. The firmware's traces (trace.h) are
+// formatted in-process, and the I2C profile of the run (per device and call
+// site) is printed at the end. --stream also sends the live stream (see
+// stream.h) to a file or a pty, for stream_recv on the other end; the traces
+// then go there too.
+
+#include "i2c_sim.h"
+#include "trace_format.h"
+
+extern "C" {
+#include "i2c_engine.h"
+#include "log_format.h"
+#include "logging.h"
+#include "pico/time.h"
+#include "scheduler.h"
+#include "sensors.h"
+#include "stream.h"
+#include "trace.h"
+}
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+FILE *log_file;
+uint32_t log_records;
+
+// the format strings and %s arguments are this process's own memory
+void print_trace(void *user, const trace_word_t *rec, size_t nwords)
+{
+    (void)user;
+    uint64_t words[TRACE_HEADER_WORDS + TRACE_MAX_ARGS];
+    for (size_t i = 0; i < nwords; i++)
+        words[i] = rec[i];
+    uint64_t now_us = time_us_64();
+    uint64_t time_us = now_us - (uint32_t)((uint32_t)now_us - (uint32_t)rec[1]);
+    std::string line = trace_format_record(
+        words, nwords, time_us,
+        [](uint64_t addr) { return reinterpret_cast<const char *>(addr); });
+    std::printf("%s\n", line.c_str());
+}
+
+void write_stream(void *user, const uint8_t *buf, size_t len)
+{
+    std::fwrite(buf, 1, len, static_cast<std::FILE *>(user));
+}
+
+} // namespace
+
+// stands in for the core1 logger: records go straight to the file
+extern "C" void log_submit(const log_t *log)
+{
+    struct log_record_t record;
+    logging_encode(log, &record);
+    if (log_file && std::fwrite(&record, sizeof record, 1, log_file) == 1)
+        log_records++;
+}
+
+int main(int argc, char **argv)
+{
+    const char *stream_path = nullptr;
+    std::vector<const char *> args;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+            stream_path = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+    double seconds = args.size() > 0 ? std::atof(args[0]) : 30;
+    const char *path = args.size() > 1 ? args[1] : "sensors_host.bin";
+    uint32_t max_hz = args.size() > 2 ? (uint32_t)std::strtoul(args[2], nullptr, 0) : 1000000;
+    SimBus bus(100000);
+    SimPayload payload;
+    payload.attach_to(bus);
+    trace_set_sink(print_trace, nullptr);
+
+    sensors_init(&bus.eng, max_hz, true);
+
+    log_config_t config = LOG_CONFIG_DEFAULT;
+    struct log_file_header_t header;
+    sensors_log_config(&config);
+    logging_build_header(&config, &header);
+    log_file = std::fopen(path, "wb");
+    if (log_file == nullptr || std::fwrite(&header, sizeof header, 1, log_file) != 1) {
+        std::fprintf(stderr, "sensors_host: cannot write %s\n", path);
+        return 1;
+    }
+
+    std::FILE *stream_file = nullptr;
+    if (stream_path) {
+        stream_file = std::fopen(stream_path, "wb");
+        if (stream_file == nullptr) {
+            std::fprintf(stderr, "sensors_host: cannot write %s\n", stream_path);
+            return 1;
+        }
+        stream_set_output(write_stream, stream_file);
+        sensors_stream(true);
+    }
+
+    uint64_t end_us = time_us_64() + (uint64_t)(seconds * 1e6);
+    sensors_start();
+    while (time_us_64() < end_us)
+        sched_run_once();
+    std::fclose(log_file);
+    if (stream_file) {
+        sensors_stream(false);
+        std::fclose(stream_file);
+        std::printf("stream: %u packets, %u bytes to %s\n", stream_get_stats()->packets,
+                    stream_get_stats()->bytes, stream_path);
+    }
+
+    const i2c_engine_stats_t &st = bus.eng.stats;
+    std::printf("%u records to %s; bus: %u transactions, %u nacks, %.1f%% busy\n",
+                log_records, path, st.completed, st.nacks,
+                100.0 * st.bus_us / (double)time_us_64());
+    sensors_print_i2c_profile();
+    return 0;
+}
@@ -0,0 +1,286 @@
+// Receives the firmware's binary live stream (see stream.h) from its USB
+// console, checks every packet and reports what was lost on the way.
+//
+//   stream_recv <tty|pty|capture> [out.bin] [--elf pico-sensors.elf]
+//
+// Start the stream with 's' over the console (or STREAM_AT_BOOT in main.c).
+// A terminal is switched to raw mode first. Records are written to out.bin
+// behind the first file header received, so log_decode reads it like a log
+// from the card. Console text between packets is passed through to stdout,
+// and so are the traces when --elf names the build that sends them (see
+// trace_decode). Once a second, and at the end, a status line on stderr
+// gives the record rate and the packets lost: sequence numbers skipped,
+// CRC failures and frames that were neither a packet nor text.
+//
+// For a test without hardware, sensors_host --stream writes the stream to a
+// file or to the other end of a pty.
+
+#include "trace_format.h"
+
+extern "C" {
+#include "cobs.h"
+#include "crc32.h"
+#include "log_format.h"
+#include "stream.h"
+#include "trace.h"
+}
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t stop;
+
+struct Stats {
+    uint64_t records = 0;
+    uint64_t headers = 0;
+    uint64_t traces = 0;
+    uint64_t dropped = 0;    // sequence numbers skipped, corrupt packets included
+    uint64_t crc_errors = 0; // decoded, but the CRC does not match
+    uint64_t bad_frames = 0; // not a packet, not text
+    uint64_t restarts = 0;   // the stream started again, e.g. after a reset
+};
+
+class Receiver {
+public:
+    Receiver(std::FILE *out, const ElfImage *elf) : out_(out), elf_(elf) {}
+
+    // feeds raw console bytes; packets and text are handled as they complete
+    void feed(const uint8_t *buf, size_t len)
+    {
+        for (size_t i = 0; i < len; i++) {
+            if (buf[i] != 0) {
+                if (frame_.size() == STREAM_MAX_FRAME)
+                    flush_text(); // too long for a packet: text, or noise
+                frame_.push_back(buf[i]);
+                continue;
+            }
+            if (!frame_.empty() && !packet())
+                flush_text();
+            frame_.clear();
+        }
+    }
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    // the frame as a packet; false if it is not one
+    bool packet()
+    {
+        uint8_t p[STREAM_MAX_FRAME]; // decoding never grows
+        const size_t head = sizeof(stream_packet_head_t);
+        size_t n = cobs_decode(frame_.data(), frame_.size(), p);
+        if (n < head + STREAM_CRC_BYTES || n > STREAM_MAX_PACKET)
+            return false;
+        n -= STREAM_CRC_BYTES;
+        uint32_t crc = p[n] | p[n + 1] << 8 | p[n + 2] << 16 | (uint32_t)p[n + 3] << 24;
+        if (crc32(0, p, n) != crc) {
+            // console text decodes too, but never to a matching CRC
+            if (is_text())
+                return false;
+            stats_.crc_errors++;
+            return true;
+        }
+        stream_packet_head_t h;
+        std::memcpy(&h, p, head);
+        // a header numbered 0 starts a new stream, so no gap is counted
+        if (h.type == stream_packet_header && h.seq == 0 && synced_) {
+            stats_.restarts++;
+            synced_ = false;
+        }
+        if (synced_)
+            stats_.dropped += (uint16_t)(h.seq - next_seq_);
+        synced_ = true;
+        next_seq_ = h.seq + 1;
+        const uint8_t *payload = p + head;
+        size_t len = n - head;
+        switch (h.type) {
+        case stream_packet_header:
+            header(payload, len);
+            break;
+        case stream_packet_record:
+            if (len != sizeof(log_record_t) || !have_header_)
+                break;
+            stats_.records++;
+            if (out_)
+                std::fwrite(payload, len, 1, out_);
+            break;
+        case stream_packet_trace:
+            trace(payload, len);
+            break;
+        }
+        return true;
+    }
+
+    void header(const uint8_t *payload, size_t len)
+    {
+        log_file_header_t hdr;
+        if (len != sizeof hdr)
+            return;
+        std::memcpy(&hdr, payload, sizeof hdr);
+        if (std::memcmp(hdr.magic, LOG_FORMAT_MAGIC, LOG_FORMAT_MAGIC_LEN) != 0 ||
+            hdr.version != LOG_FORMAT_VERSION || hdr.record_bytes != sizeof(log_record_t))
+            return;
+        stats_.headers++;
+        if (have_header_) {
+            if (std::memcmp(&hdr, &header_, sizeof hdr) != 0)
+                std::fprintf(stderr, "stream_recv: the file header changed, keeping the first\n");
+            return;
+        }
+        header_ = hdr;
+        have_header_ = true;
+        if (out_)
+            std::fwrite(&hdr, sizeof hdr, 1, out_);
+    }
+
+    void trace(const uint8_t *payload, size_t len)
+    {
+        stats_.traces++;
+        if (!elf_ || len % 4 != 0 || len / 4 > TRACE_HEADER_WORDS + TRACE_MAX_ARGS)
+            return;
+        uint64_t rec[TRACE_HEADER_WORDS + TRACE_MAX_ARGS];
+        size_t nwords = len / 4;
+        for (size_t i = 0; i < nwords; i++)
+            rec[i] = payload[4 * i] | payload[4 * i + 1] << 8 | payload[4 * i + 2] << 16 |
+                     (uint32_t)payload[4 * i + 3] << 24;
+        if (nwords >= 2)
+            trace_time_us_ += (uint32_t)((uint32_t)rec[1] - (uint32_t)trace_time_us_);
+        std::string line = trace_format_record(
+            rec, nwords, trace_time_us_, [this](uint64_t addr) { return elf_->string_at(addr); });
+        std::printf("%s\n", line.c_str());
+    }
+
+    bool is_text() const
+    {
+        for (uint8_t c : frame_)
+            if (!std::isprint(c) && !std::isspace(c))
+                return false;
+        return true;
+    }
+
+    // console output between packets goes through; anything else is counted
+    void flush_text()
+    {
+        if (is_text())
+            std::fwrite(frame_.data(), 1, frame_.size(), stdout);
+        else
+            stats_.bad_frames++;
+        frame_.clear();
+    }
+
+    std::FILE *out_;
+    const ElfImage *elf_;
+    std::vector<uint8_t> frame_;
+    Stats stats_;
+    bool synced_ = false;
+    uint16_t next_seq_ = 0;
+    bool have_header_ = false;
+    log_file_header_t header_{};
+    uint64_t trace_time_us_ = 0;
+};
+
+void print_status(const Stats &st, const char *rate, const char *end)
+{
+    std::fprintf(stderr,
+                 "%llu records%s, %llu dropped, %llu CRC errors, %llu bad frames, "
+                 "%llu restarts%s",
+                 (unsigned long long)st.records, rate, (unsigned long long)st.dropped,
+                 (unsigned long long)st.crc_errors,
+                 (unsigned long long)st.bad_frames, (unsigned long long)st.restarts, end);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *in_path = nullptr;
+    const char *out_path = nullptr;
+    const char *elf_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--elf") == 0 && i + 1 < argc)
+            elf_path = argv[++i];
+        else if (!in_path)
+            in_path = argv[i];
+        else if (!out_path)
+            out_path = argv[i];
+    }
+    if (!in_path) {
+        std::fprintf(stderr, "usage: stream_recv <tty|pty|capture> [out.bin] [--elf firmware.elf]\n");
+        return 2;
+    }
+    // with a wrong table every packet would count as corrupt
+    if (crc32(0, "123456789", 9) != CRC32_CHECK) {
+        std::fprintf(stderr, "stream_recv: crc32 does not match CRC32_CHECK\n");
+        return 1;
+    }
+    ElfImage elf;
+    if (elf_path && !elf.load(elf_path)) {
+        std::fprintf(stderr, "stream_recv: %s is not a 32-bit little-endian ELF file\n", elf_path);
+        return 1;
+    }
+    int fd = open(in_path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        std::fprintf(stderr, "stream_recv: cannot open %s: %s\n", in_path, std::strerror(errno));
+        return 1;
+    }
+    struct termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    std::FILE *out = nullptr;
+    if (out_path && (out = std::fopen(out_path, "wb")) == nullptr) {
+        std::fprintf(stderr, "stream_recv: cannot write %s\n", out_path);
+        return 1;
+    }
+    // Ctrl-C ends the run with the summary; read() returns EINTR
+    struct sigaction sa {};
+    sa.sa_handler = [](int) { stop = 1; };
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    Receiver rx(out, elf_path ? &elf : nullptr);
+    using clock = std::chrono::steady_clock;
+    clock::time_point next_status = clock::now() + std::chrono::seconds(1);
+    uint64_t records_at_status = 0;
+    bool tty = isatty(STDERR_FILENO);
+    uint8_t buf[4096];
+    while (!stop) {
+        ssize_t n = read(fd, buf, sizeof buf);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break; // end of a capture, or the device went away (EIO on a pty)
+        rx.feed(buf, (size_t)n);
+        clock::time_point now = clock::now();
+        if (now >= next_status) {
+            std::string rate =
+                " (" + std::to_string(rx.stats().records - records_at_status) + "/s)";
+            // overwritten in place on a terminal
+            print_status(rx.stats(), rate.c_str(), tty ? "\r" : "\n");
+            records_at_status = rx.stats().records;
+            next_status = now + std::chrono::seconds(1);
+        }
+    }
+    close(fd);
+    if (out)
+        std::fclose(out);
+    std::fflush(stdout);
+    const Stats &st = rx.stats();
+    print_status(st, "", "\n");
+    std::fprintf(stderr, "%llu file headers, %llu traces\n", (unsigned long long)st.headers,
+                 (unsigned long long)st.traces);
+    return 0;
+}
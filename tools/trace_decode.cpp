@@ -0,0 +1,67 @@
+// Formats the deferred traces (see trace.h) in a capture of the firmware's
+// USB console, passing the console's text through unchanged.
+//
+//   trace_decode pico-sensors.elf [capture=stdin]
+//
+// The device sends each trace as a binary frame holding the address of its
+// format string and its raw arguments; the strings are looked up in the ELF
+// file of the exact build that produced the capture. Capture the console
+// raw, e.g. stty -F /dev/ttyACM0 raw && trace_decode pico-sensors.elf /dev/ttyACM0
+
+#include "trace.h"
+#include "trace_format.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: trace_decode firmware.elf [capture]\n");
+        return 2;
+    }
+    ElfImage elf;
+    if (!elf.load(argv[1])) {
+        std::fprintf(stderr, "trace_decode: %s is not a 32-bit little-endian ELF file\n",
+                     argv[1]);
+        return 1;
+    }
+    std::FILE *in = argc > 2 ? std::fopen(argv[2], "rb") : stdin;
+    if (in == nullptr) {
+        std::fprintf(stderr, "trace_decode: cannot open %s\n", argv[2]);
+        return 1;
+    }
+    TraceResolve resolve = [&elf](uint64_t addr) { return elf.string_at(addr); };
+
+    uint64_t time_us = 0; // time_us_32() of the traces, unwrapped
+    bool at_line_start = true;
+    int c;
+    while ((c = std::fgetc(in)) != EOF) {
+        if (c != TRACE_FRAME_START) {
+            std::putchar(c);
+            at_line_start = c == '\n';
+            continue;
+        }
+        int len = std::fgetc(in);
+        uint8_t bytes[255];
+        if (len == EOF || len % 4 != 0 ||
+            std::fread(bytes, 1, (size_t)len, in) != (size_t)len)
+            break;
+        std::vector<uint64_t> rec(len / 4);
+        for (size_t i = 0; i < rec.size(); i++)
+            rec[i] = bytes[4 * i] | bytes[4 * i + 1] << 8 | bytes[4 * i + 2] << 16 |
+                     (uint32_t)bytes[4 * i + 3] << 24;
+        if (rec.size() >= 2) {
+            uint32_t t = (uint32_t)rec[1];
+            time_us += (uint32_t)(t - (uint32_t)time_us);
+        }
+        if (!at_line_start)
+            std::putchar('\n');
+        std::printf("%s\n", trace_format_record(rec.data(), rec.size(), time_us, resolve).c_str());
+        at_line_start = true;
+    }
+    std::fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "trace_format.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const char *const CONVERSIONS = "diouxXcsfFeEgGaAp%";
+const char *const LENGTHS = "hlLqjzt";
+
+float float_bits(uint64_t w)
+{
+    uint32_t bits = (uint32_t)w;
+    float f;
+    std::memcpy(&f, &bits, sizeof f);
+    return f;
+}
+
+template <typename T> std::string sprint(const std::string &spec, T v)
+{
+    char buf[128];
+    std::snprintf(buf, sizeof buf, spec.c_str(), v);
+    return buf;
+}
+
+} // namespace
+
+std::string trace_format(const char *fmt, const uint64_t *args, size_t nargs,
+                         const TraceResolve &resolve)
+{
+    std::string out;
+    size_t next = 0;
+    const char *p = fmt;
+    while (*p) {
+        if (*p != '%') {
+            out += *p++;
+            continue;
+        }
+        // flags, width and precision are kept, length modifiers dropped:
+        // every argument is a 32-bit word
+        std::string spec = "%";
+        p++;
+        while (*p && !std::strchr(CONVERSIONS, *p)) {
+            if (*p == '*')
+                spec += std::to_string(next < nargs ? (int32_t)args[next++] : 0);
+            else if (!std::strchr(LENGTHS, *p))
+                spec += *p;
+            p++;
+        }
+        if (*p == '\0')
+            break;
+        char conv = *p++;
+        if (conv == '%') {
+            out += '%';
+            continue;
+        }
+        if (next >= nargs) {
+            out += "<?>";
+            continue;
+        }
+        uint64_t w = args[next++];
+        switch (conv) {
+        case 'd':
+        case 'i':
+            out += sprint(spec + 'd', (int)(int32_t)w);
+            break;
+        case 'c':
+            out += sprint(spec + 'c', (int)(int32_t)w);
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            out += sprint(spec + conv, (unsigned)(uint32_t)w);
+            break;
+        case 's': {
+            const char *s = resolve(w);
+            if (s)
+                out += sprint(spec + 's', s);
+            else
+                out += sprint("<string at 0x%08llx>", (unsigned long long)w);
+            break;
+        }
+        case 'p':
+            out += sprint("0x%08llx", (unsigned long long)w);
+            break;
+        default:
+            out += sprint(spec + conv, (double)float_bits(w));
+            break;
+        }
+    }
+    return out;
+}
+
+std::string trace_format_record(const uint64_t *rec, size_t nwords, uint64_t time_us,
+                                const TraceResolve &resolve)
+{
+    char prefix[40];
+    const char *fmt = nwords >= 3 ? resolve(rec[0]) : nullptr;
+    if (fmt == nullptr || fmt[0] == '\0') {
+        std::snprintf(prefix, sizeof prefix, "[%8llu.%06llu ?] ",
+                      (unsigned long long)(time_us / 1000000),
+                      (unsigned long long)(time_us % 1000000));
+        return prefix + sprint("unknown trace format at 0x%08llx",
+                               (unsigned long long)(nwords ? rec[0] : 0));
+    }
+    std::snprintf(prefix, sizeof prefix, "[%8llu.%06llu %c] ",
+                  (unsigned long long)(time_us / 1000000),
+                  (unsigned long long)(time_us % 1000000), fmt[0]);
+    size_t nargs = nwords - 3 < rec[2] ? nwords - 3 : (size_t)rec[2];
+    return prefix + trace_format(fmt + 1, rec + 3, nargs, resolve);
+}
+
+bool ElfImage::load(const char *path)
+{
+    std::ifstream in(path, std::ios::binary);
+    data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    sections_.clear();
+    if (data_.size() < 52 || std::memcmp(data_.data(), "\x7f" "ELF", 4) != 0 ||
+        data_[4] != 1 || data_[5] != 1)
+        return false; // not ELF32, little-endian
+    uint32_t shoff = u32(0x20);
+    uint16_t shentsize = u16(0x2E);
+    uint16_t shnum = u16(0x30);
+    if (shentsize < 40 || (uint64_t)shoff + (uint64_t)shentsize * shnum > data_.size())
+        return false;
+    for (uint16_t i = 0; i < shnum; i++) {
+        size_t sh = shoff + (size_t)i * shentsize;
+        uint32_t type = u32(sh + 4);
+        uint32_t flags = u32(sh + 8);
+        Section s{u32(sh + 12), u32(sh + 16), u32(sh + 20)};
+        const uint32_t SHT_NOBITS = 8, SHF_ALLOC = 2;
+        if ((flags & SHF_ALLOC) && type != SHT_NOBITS &&
+            (uint64_t)s.offset + s.size <= data_.size())
+            sections_.push_back(s);
+    }
+    return true;
+}
+
+const char *ElfImage::string_at(uint64_t addr) const
+{
+    for (const Section &s : sections_) {
+        if (addr < s.addr || addr >= (uint64_t)s.addr + s.size)
+            continue;
+        const char *p = data_.data() + s.offset + (addr - s.addr);
+        size_t room = s.addr + s.size - addr;
+        return memchr(p, '\0', room) ? p : nullptr;
+    }
+    return nullptr;
+}
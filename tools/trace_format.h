@@ -0,0 +1,53 @@
+// Host side of the firmware's deferred traces (trace.h): turns a recorded
+// trace, i.e. the address of its format string, its time and its raw
+// argument words, into the text the device would have printed.
+
+#ifndef TOOLS_TRACE_FORMAT_H
+#define TOOLS_TRACE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// the NUL-terminated string at a device address, nullptr if there is none
+using TraceResolve = std::function<const char *(uint64_t addr)>;
+
+// fmt as the device's printf would have formatted it with args: every
+// conversion takes one word (integers as 32 bits, floating point as float
+// bits, %s as a string address); '*' widths and precisions take one too
+std::string trace_format(const char *fmt, const uint64_t *args, size_t nargs,
+                         const TraceResolve &resolve);
+
+// one trace record as trace.h lays it out (format, time, count, arguments)
+// as a console line: "[   12.345678 I] text". time_us is the record's
+// time already unwrapped to 64 bits
+std::string trace_format_record(const uint64_t *rec, size_t nwords, uint64_t time_us,
+                                const TraceResolve &resolve);
+
+// the allocated sections of a 32-bit little-endian ELF file (the RP2350's),
+// where the format strings of a capture are looked up
+class ElfImage {
+public:
+    bool load(const char *path); // false if path is not such a file
+    const char *string_at(uint64_t addr) const;
+
+private:
+    struct Section {
+        uint32_t addr;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    uint16_t u16(size_t at) const
+    {
+        return (uint16_t)((uint8_t)data_[at] | (uint8_t)data_[at + 1] << 8);
+    }
+    uint32_t u32(size_t at) const { return u16(at) | (uint32_t)u16(at + 2) << 16; }
+
+    std::vector<char> data_;
+    std::vector<Section> sections_;
+};
+
+#endif
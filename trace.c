@@ -0,0 +1,103 @@
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#define RING_MASK (TRACE_RING_WORDS - 1)
+_Static_assert((TRACE_RING_WORDS & RING_MASK) == 0, "TRACE_RING_WORDS must be a power of two");
+_Static_assert(TRACE_HEADER_WORDS + TRACE_MAX_ARGS <= TRACE_RING_WORDS, "a trace must fit the ring");
+
+static trace_word_t trace_ring[TRACE_RING_WORDS];
+// free-running word indices: trace_record appends at head, the drain frees
+// from tail
+static volatile uint32_t trace_head;
+static volatile uint32_t trace_tail;
+static trace_stats_t trace_stats;
+static trace_sink_t trace_sink;
+static void *trace_sink_user;
+
+/*
+PRE:
+- args holds nargs words, nargs <= TRACE_MAX_ARGS
+PURPOSE:
+- appends fmt, the time and the arguments to the ring, or counts a drop if
+    they do not fit; the whole record appears at once, so a drain never
+    sees half of one
+*/
+void trace_record(const char *fmt, const trace_word_t *args, size_t nargs)
+{
+    uint32_t saved = save_and_disable_interrupts();
+    uint32_t head = trace_head;
+    uint32_t nwords = TRACE_HEADER_WORDS + (uint32_t)nargs;
+    if (TRACE_RING_WORDS - (head - trace_tail) < nwords)
+    {
+        trace_stats.dropped++;
+        restore_interrupts(saved);
+        return;
+    }
+    trace_ring[head++ & RING_MASK] = (trace_word_t)fmt;
+    trace_ring[head++ & RING_MASK] = time_us_32();
+    trace_ring[head++ & RING_MASK] = nargs;
+    for (size_t i = 0; i < nargs; i++)
+        trace_ring[head++ & RING_MASK] = args[i];
+    trace_head = head;
+    trace_stats.traces++;
+    restore_interrupts(saved);
+}
+
+// one TRACE_FRAME_START frame per trace, 4 bytes per word
+static void trace_console_sink(void *user, const trace_word_t *rec, size_t nwords)
+{
+    (void)user;
+    putchar_raw(TRACE_FRAME_START);
+    putchar_raw((int)(nwords * 4));
+    for (size_t i = 0; i < nwords; i++)
+    {
+        uint32_t w = (uint32_t)rec[i];
+        putchar_raw(w & 0xFF);
+        putchar_raw(w >> 8 & 0xFF);
+        putchar_raw(w >> 16 & 0xFF);
+        putchar_raw(w >> 24);
+    }
+    trace_stats.frames++;
+}
+
+// where trace_flush sends the traces; NULL selects the console frames
+void trace_set_sink(trace_sink_t sink, void *user)
+{
+    trace_sink = sink;
+    trace_sink_user = user;
+}
+
+size_t trace_flush(void)
+{
+    return trace_flush_to(trace_sink ? trace_sink : trace_console_sink, trace_sink_user);
+}
+
+/*
+PURPOSE:
+- hands every trace recorded so far to sink, oldest first, and frees its
+    ring space; returns how many. Runs in thread context, on core0
+*/
+size_t trace_flush_to(trace_sink_t sink, void *user)
+{
+    uint32_t head = trace_head;
+    uint32_t tail = trace_tail;
+    size_t n = 0;
+    while (tail != head)
+    {
+        trace_word_t rec[TRACE_HEADER_WORDS + TRACE_MAX_ARGS];
+        size_t nwords = TRACE_HEADER_WORDS + trace_ring[(tail + 2) & RING_MASK];
+        for (size_t i = 0; i < nwords; i++)
+            rec[i] = trace_ring[(tail + i) & RING_MASK];
+        sink(user, rec, nwords);
+        tail += nwords;
+        trace_tail = tail;
+        n++;
+    }
+    return n;
+}
+
+const trace_stats_t *trace_get_stats(void)
+{
+    return &trace_stats;
+}
@@ -0,0 +1,145 @@
+/*
+DEFERRED TRACE LOGGING
+- TRACE_ERROR/WARN/INFO/DEBUG(fmt, ...) take printf format strings, but
+    nothing is formatted on the device: a trace records the address of its
+    format string, the time and its raw arguments in a RAM ring, a handful
+    of word stores. trace_flush drains the ring in the background, by
+    default to the console as binary frames, and tools/trace_decode formats
+    them on the host with the strings from the firmware's ELF file
+- levels above TRACE_LEVEL compile to nothing, arguments included
+- every argument travels as one 32-bit word: integers up to 32 bits, float
+    and double (as a float), and pointers. A %s argument must point at a
+    string in the firmware image (a literal, a const table), since only
+    its address is sent
+- traces may be issued from interrupt handlers on core0; a full ring drops
+    new traces and counts them
+This file is plain C; tools/host provides the little of the Pico SDK it needs.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_LEVEL_OFF 0
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_WARN 2
+#define TRACE_LEVEL_INFO 3
+#define TRACE_LEVEL_DEBUG 4
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_INFO
+#endif
+
+#define TRACE_RING_WORDS 1024 // power of two
+#define TRACE_MAX_ARGS 8
+#define TRACE_HEADER_WORDS 3 // format, time, number of arguments
+
+// the console frame of one trace: TRACE_FRAME_START, the payload length in
+// bytes, then the record's words, little-endian. The console's text is
+// UTF-8, which never contains TRACE_FRAME_START
+#define TRACE_FRAME_START 0xFF
+
+// a pointer on the device, so the host tools can resolve it
+typedef uintptr_t trace_word_t;
+
+typedef struct
+{
+    uint32_t traces;  // recorded
+    uint32_t dropped; // lost to a full ring
+    uint32_t frames;  // sent to the console
+} trace_stats_t;
+
+// a trace as recorded: format, time_us_32(), number of arguments, arguments
+typedef void (*trace_sink_t)(void *user, const trace_word_t *rec, size_t nwords);
+
+void trace_record(const char *fmt, const trace_word_t *args, size_t nargs);
+void trace_set_sink(trace_sink_t sink, void *user);
+size_t trace_flush(void);
+size_t trace_flush_to(trace_sink_t sink, void *user);
+const trace_stats_t *trace_get_stats(void);
+
+static inline trace_word_t trace_word(uint32_t v)
+{
+    return v;
+}
+
+static inline trace_word_t trace_float(double v)
+{
+    float f = (float)v;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof bits);
+    return bits;
+}
+
+static inline trace_word_t trace_ptr(const void *p)
+{
+    return (trace_word_t)p;
+}
+
+#define TRACE_ARG(X)                                                                   \
+    _Generic((X), float: trace_float, double: trace_float, char *: trace_ptr,          \
+             const char *: trace_ptr, void *: trace_ptr, const void *: trace_ptr,      \
+             default: trace_word)(X)
+
+// , TRACE_ARG(a) for every argument
+#define TRACE_ARGS0()
+#define TRACE_ARGS1(A) , TRACE_ARG(A)
+#define TRACE_ARGS2(A, ...) , TRACE_ARG(A) TRACE_ARGS1(__VA_ARGS__)
+#define TRACE_ARGS3(A, ...) , TRACE_ARG(A) TRACE_ARGS2(__VA_ARGS__)
+#define TRACE_ARGS4(A, ...) , TRACE_ARG(A) TRACE_ARGS3(__VA_ARGS__)
+#define TRACE_ARGS5(A, ...) , TRACE_ARG(A) TRACE_ARGS4(__VA_ARGS__)
+#define TRACE_ARGS6(A, ...) , TRACE_ARG(A) TRACE_ARGS5(__VA_ARGS__)
+#define TRACE_ARGS7(A, ...) , TRACE_ARG(A) TRACE_ARGS6(__VA_ARGS__)
+#define TRACE_ARGS8(A, ...) , TRACE_ARG(A) TRACE_ARGS7(__VA_ARGS__)
+#define TRACE_ARGS_PICK(_0, _1, _2, _3, _4, _5, _6, _7, _8, NAME, ...) NAME
+#define TRACE_ARGS(...)                                                                 \
+    TRACE_ARGS_PICK(_0, ##__VA_ARGS__, TRACE_ARGS8, TRACE_ARGS7, TRACE_ARGS6,           \
+                    TRACE_ARGS5, TRACE_ARGS4, TRACE_ARGS3, TRACE_ARGS2, TRACE_ARGS1,    \
+                    TRACE_ARGS0)(__VA_ARGS__)
+
+// the format string starts with the level's letter, for the host
+#define TRACE_AT(LETTER, FMT, ...)                                             \
+    do                                                                         \
+    {                                                                          \
+        static const char trace_fmt[] = LETTER FMT;                            \
+        const trace_word_t trace_args[] = {0 TRACE_ARGS(__VA_ARGS__)};         \
+        trace_record(trace_fmt, trace_args + 1,                                \
+                     sizeof trace_args / sizeof *trace_args - 1);              \
+    } while (0)
+
+#define TRACE_NOTHING(...) \
+    do                     \
+    {                      \
+    } while (0)
+
+#if TRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(FMT, ...) TRACE_AT("E", FMT, ##__VA_ARGS__)
+#else
+#define TRACE_ERROR TRACE_NOTHING
+#endif
+#if TRACE_LEVEL >= TRACE_LEVEL_WARN
+#define TRACE_WARN(FMT, ...) TRACE_AT("W", FMT, ##__VA_ARGS__)
+#else
+#define TRACE_WARN TRACE_NOTHING
+#endif
+#if TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(FMT, ...) TRACE_AT("I", FMT, ##__VA_ARGS__)
+#else
+#define TRACE_INFO TRACE_NOTHING
+#endif
+#if TRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(FMT, ...) TRACE_AT("D", FMT, ##__VA_ARGS__)
+#else
+#define TRACE_DEBUG TRACE_NOTHING
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
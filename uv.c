@@ -6,25 +6,22 @@
  * - VEML6075 SCL -> Pico GPIO 5 (I2C0 SCL)
  * - VEML6075 VCC -> Pico 3.3V
  * - VEML6075 GND -> Pico GND
+ *
+ * The clock is the bus's business: at most VEML6075_MAX_HZ, see sensors.c
  */
 
 #include <stdio.h>
 #include "pico/stdlib.h"
-#include "hardware/i2c.h"
 #include "veml6075.h"
-
-// I2C configuration
-#define I2C_PORT i2c0
-#define I2C_SDA 4
-#define I2C_SCL 5
-#define I2C_FREQ 100000  // 100kHz
+#include "uv.h"
+#include "trace.h"
 
 VEML6075_t uv_sensor;
 VEML6075_error_t err;
 
-void init_uv_sensor(void) {
+void init_uv_sensor(const i2c_device_t *dev) {
         // Initialize VEML6075
-    err = veml6075_init(&uv_sensor, I2C_PORT);
+    err = veml6075_init(&uv_sensor, dev);
     
     if (err != VEML6075_ERROR_SUCCESS) {
         printf("Failed to initialize VEML6075! Error: %d\n", err);
@@ -42,24 +39,84 @@ void init_uv_sensor(void) {
     // Configure sensor (optional - these are already set in init)
     veml6075_set_integration_time(&uv_sensor, IT_100MS);
     veml6075_set_high_dynamic(&uv_sensor, DYNAMIC_NORMAL);
+    // triggered acquisition: one integration per sample, idle in between
+    veml6075_set_auto_force(&uv_sensor, AF_ENABLE);
+    // IT and HD follow the light level from here on; 800 ms still fits the
+    // 1 s sample period
+    veml6075_set_auto_range(&uv_sensor, true, IT_800MS);
+}
+
+// starts the integration for the next get_uv()
+void start_uv(void) {
+    err = veml6075_start_measurement(&uv_sensor);
+    if (err != VEML6075_ERROR_SUCCESS) {
+        TRACE_ERROR("VEML6075 trigger failed! Error: %d", err);
+    }
+}
+
+// how long before get_uv() start_uv() should be called
+uint32_t get_uv_lead_ms(void) {
+    return veml6075_measurement_ms(&uv_sensor);
 }
 
-float get_uv() {
+static uint64_t uv_time_us;
+static unsigned long uv_not_ready;
+
+// never waits: a result that is not there yet (UV_TRIG still set) keeps the
+// last index, and the next period's read tries again
+uv_index_t get_uv() {
+        static uv_index_t uv_index; // kept when a read fails
+        // one read of UVA, UVB, UVCOMP1 and UVCOMP2 from the integration
+        // start_uv() triggered; everything below is computed from that set
+        veml6075_snapshot_t snap;
+        if (!uv_sensor.measuring) {
+            start_uv();
+        }
+        err = veml6075_read_measurement(&uv_sensor, &snap);
+        if (err == VEML6075_ERROR_NOT_READY) {
+            uv_not_ready++;
+            TRACE_ERROR("VEML6075 not ready (%lu times)", uv_not_ready);
+            return uv_index;
+        }
+        if (err != VEML6075_ERROR_SUCCESS) {
+            TRACE_ERROR("VEML6075 read failed");
+            return uv_index;
+        }
+        
+        uv_time_us = snap.time_us;
+        
         // // Get raw values
-        // uint16_t raw_uva = veml6075_get_raw_uva(&uv_sensor);
-        // uint16_t raw_uvb = veml6075_get_raw_uvb(&uv_sensor);
+        // printf("raw UVA: %u, raw UVB: %u\n", snap.uva, snap.uvb);
         
-        // // Get compensated values
-        float uva = veml6075_get_uva(&uv_sensor);
-        float uvb = veml6075_get_uvb(&uv_sensor);
-        printf("UVA: %.2f, UVB: %.2f\n", uva, uvb);
+#if SENSORS_FIXED_POINT
+        // compensated counts and Q16 index, no float anywhere
+        TRACE_DEBUG("UVA: %ld, UVB: %ld", veml6075_snapshot_uva_counts(&snap),
+                    veml6075_snapshot_uvb_counts(&snap));
+        uv_index = veml6075_snapshot_index_q16(&snap);
+#else
+        // compensated values, only computed when traced
+        TRACE_DEBUG("UVA: %.2f, UVB: %.2f", veml6075_snapshot_uva(&snap),
+                    veml6075_snapshot_uvb(&snap));
         
         // Get UV index
-        float uv_index = veml6075_get_index(&uv_sensor);
+        uv_index = veml6075_snapshot_index(&uv_sensor, &snap);
+#endif
         
     return uv_index;
 }
 
+// when the registers behind the last get_uv() value were read
+uint64_t get_uv_time_us(void) {
+    return uv_time_us;
+}
+
+// cached by the driver, no bus traffic; with auto-ranging this is only the
+// range the next measurement starts with
+void get_uv_settings(uint16_t *it_ms, bool *hd) {
+    *it_ms = uv_sensor.integration_time;
+    *hd = uv_sensor.hd_enabled;
+}
+
 // Example CMakeLists.txt content:
 /*
 cmake_minimum_required(VERSION 3.13)
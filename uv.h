@@ -1,7 +1,16 @@
 #ifndef YOUVEE_H
 #define YOUVEE_H
 
-void init_uv_sensor(void);
-float get_uv();
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed_point.h"
+#include "i2c_device.h"
+
+void init_uv_sensor(const i2c_device_t *dev);
+void start_uv(void);
+uint32_t get_uv_lead_ms(void);
+uv_index_t get_uv();
+uint64_t get_uv_time_us(void);
+void get_uv_settings(uint16_t *it_ms, bool *hd);
 
 #endif
@@ -21,6 +21,18 @@
 #define VEML6075_AF_MASK 0x02
 #define VEML6075_AF_SHIFT 1
 
+// Active force timing: the internal oscillator may run slow, so allow for it
+// on top of the nominal integration time before reading. UV_TRIG clearing
+// itself is what actually says the measurement is done.
+#define VEML6075_IT_TOLERANCE_DIV 8
+#define VEML6075_TRIGGER_MARGIN_MS 2
+
+// Auto-ranging: every ladder step roughly halves or doubles the counts, so
+// after a step a reading sits well inside the opposite threshold and the
+// range cannot flip back and forth
+#define VEML6075_RANGE_HIGH_COUNTS 0xE000 // ~87% of full scale
+#define VEML6075_RANGE_LOW_COUNTS 0x3000  // ~19%, still < HIGH / 2 after a step
+
 // Calculation constants
 static const float HD_SCALAR = 2.0f;
 static const float UV_ALPHA = 1.0f;
@@ -36,6 +48,34 @@ static const float UVA_D_COEF = 1.75f;
 static const float UVA_RESPONSIVITY_100MS_UNCOVERED = 0.001111f;
 static const float UVB_RESPONSIVITY_100MS_UNCOVERED = 0.00125f;
 
+// The same constants for the fixed-point path (see fixed_point.h). Folded by
+// the compiler: no floating point is left at run time.
+#define UV_Q16(X) ((int64_t)((X) * 65536.0 + 0.5))
+#define UV_Q32(X) ((int64_t)((X) * 4294967296.0 + 0.5))
+#define UVA_RESP_100MS 0.001111
+#define UVB_RESP_100MS 0.00125
+
+static const int64_t UVA_A_COEF_Q16 = UV_Q16(2.22);
+static const int64_t UVA_B_COEF_Q16 = UV_Q16(1.33);
+static const int64_t UVA_C_COEF_Q16 = UV_Q16(2.95);
+static const int64_t UVA_D_COEF_Q16 = UV_Q16(1.75);
+
+static const int64_t UVA_RESPONSIVITY_Q32[NUM_INTEGRATION_TIMES] = {
+    UV_Q32(UVA_RESP_100MS / 0.5016286645), // 50ms
+    UV_Q32(UVA_RESP_100MS),                // 100ms
+    UV_Q32(UVA_RESP_100MS / 2.039087948),  // 200ms
+    UV_Q32(UVA_RESP_100MS / 3.781758958),  // 400ms
+    UV_Q32(UVA_RESP_100MS / 7.371335505)   // 800ms
+};
+
+static const int64_t UVB_RESPONSIVITY_Q32[NUM_INTEGRATION_TIMES] = {
+    UV_Q32(UVB_RESP_100MS / 0.5016286645), // 50ms
+    UV_Q32(UVB_RESP_100MS),                // 100ms
+    UV_Q32(UVB_RESP_100MS / 2.039087948),  // 200ms
+    UV_Q32(UVB_RESP_100MS / 3.781758958),  // 400ms
+    UV_Q32(UVB_RESP_100MS / 7.371335505)   // 800ms
+};
+
 static const float UVA_RESPONSIVITY[NUM_INTEGRATION_TIMES] = {
     UVA_RESPONSIVITY_100MS_UNCOVERED / 0.5016286645f, // 50ms
     UVA_RESPONSIVITY_100MS_UNCOVERED,                 // 100ms
@@ -52,6 +92,22 @@ static const float UVB_RESPONSIVITY[NUM_INTEGRATION_TIMES] = {
     UVB_RESPONSIVITY_100MS_UNCOVERED / 7.371335505f   // 800ms
 };
 
+// Auto-range ladder, least sensitive first. HD halves the sensitivity.
+static const struct {
+    veml6075_uv_it_t it;
+    veml6075_hd_t hd;
+} RANGES[] = {
+    {IT_50MS, DYNAMIC_HIGH},
+    {IT_50MS, DYNAMIC_NORMAL},
+    {IT_100MS, DYNAMIC_NORMAL},
+    {IT_200MS, DYNAMIC_NORMAL},
+    {IT_400MS, DYNAMIC_NORMAL},
+    {IT_800MS, DYNAMIC_NORMAL},
+};
+#define NUM_RANGES (sizeof(RANGES) / sizeof(RANGES[0]))
+
+static const uint16_t INTEGRATION_MS[NUM_INTEGRATION_TIMES] = {50, 100, 200, 400, 800};
+
 // Private helper functions
 static VEML6075_error_t read_i2c_buffer(VEML6075_t *dev, uint8_t *dest, 
                                         VEML6075_REGISTER_t start_reg, uint16_t len) {
@@ -59,13 +115,8 @@ static VEML6075_error_t read_i2c_buffer(VEML6075_t *dev, uint8_t *dest,
         return VEML6075_ERROR_INVALID_ADDRESS;
     }
     
-    int ret = i2c_write_blocking(dev->i2c, dev->device_address, 
-                                 (uint8_t*)&start_reg, 1, true);
-    if (ret < 0) {
-        return VEML6075_ERROR_READ;
-    }
-    
-    ret = i2c_read_blocking(dev->i2c, dev->device_address, dest, len, false);
+    uint8_t reg = (uint8_t)start_reg;
+    int ret = i2c_device_write_read(dev->i2c, &reg, 1, dest, len, NULL);
     if (ret < 0) {
         return VEML6075_ERROR_READ;
     }
@@ -83,7 +134,7 @@ static VEML6075_error_t write_i2c_buffer(VEML6075_t *dev, uint8_t *src,
     buffer[0] = start_reg;
     memcpy(buffer + 1, src, len);
     
-    int ret = i2c_write_blocking(dev->i2c, dev->device_address, buffer, len + 1, false);
+    int ret = i2c_device_write(dev->i2c, buffer, len + 1);
     if (ret < 0) {
         return VEML6075_ERROR_WRITE;
     }
@@ -91,6 +142,50 @@ static VEML6075_error_t write_i2c_buffer(VEML6075_t *dev, uint8_t *src,
     return VEML6075_ERROR_SUCCESS;
 }
 
+// Reads several registers with one command code each, all queued on the
+// engine at once so they go out back to back. The part has no auto-increment
+// between command codes, so this is as close to a burst as it gets.
+// o_complete_us gets the time the last of them finished.
+static VEML6075_error_t read_i2c_registers(VEML6075_t *dev, uint16_t *dest,
+                                           const uint8_t *regs, size_t n,
+                                           uint64_t *o_complete_us) {
+    i2c_txn_t txns[n];
+    uint8_t data[n][VEML6075_REGISTER_LENGTH];
+    VEML6075_error_t err = VEML6075_ERROR_SUCCESS;
+    size_t submitted = 0;
+
+    if (dev->device_address != VEML6075_ADDRESS) {
+        return VEML6075_ERROR_INVALID_ADDRESS;
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        txns[i] = (i2c_txn_t){
+            .wr = &regs[i],
+            .wr_len = 1,
+            .rd = data[i],
+            .rd_len = VEML6075_REGISTER_LENGTH};
+        if (!i2c_device_submit(dev->i2c, &txns[i])) {
+            err = VEML6075_ERROR_READ;
+            break;
+        }
+        submitted++;
+    }
+    // every submitted transaction has to finish before txns goes out of scope
+    for (size_t i = 0; i < submitted; i++) {
+        if (i2c_device_wait(dev->i2c, &txns[i]) != i2c_txn_done) {
+            err = VEML6075_ERROR_READ;
+        }
+    }
+    if (err != VEML6075_ERROR_SUCCESS) {
+        return err;
+    }
+    for (size_t i = 0; i < n; i++) {
+        dest[i] = data[i][0] | ((uint16_t)data[i][1] << 8);
+    }
+    *o_complete_us = txns[n - 1].complete_us;
+    return VEML6075_ERROR_SUCCESS;
+}
+
 static VEML6075_error_t read_i2c_register(VEML6075_t *dev, uint16_t *dest, 
                                           VEML6075_REGISTER_t reg_addr) {
     uint8_t temp_dest[2];
@@ -106,7 +201,20 @@ static VEML6075_error_t write_i2c_register(VEML6075_t *dev, uint16_t data,
     uint8_t d[2];
     d[0] = (uint8_t)(data & 0x00FF);
     d[1] = (uint8_t)((data & 0xFF00) >> 8);
-    return write_i2c_buffer(dev, d, reg_addr, VEML6075_REGISTER_LENGTH);
+    VEML6075_error_t err = write_i2c_buffer(dev, d, reg_addr, VEML6075_REGISTER_LENGTH);
+    if (err == VEML6075_ERROR_SUCCESS && reg_addr == REG_UV_CONF) {
+        // UV_TRIG clears itself, the shadow must not keep it
+        dev->conf = data & ~VEML6075_TRIG_MASK;
+    }
+    return err;
+}
+
+// PRE: it < IT_RESERVED_0
+static void set_it_fields(VEML6075_t *dev, veml6075_uv_it_t it) {
+    dev->it = it;
+    dev->a_responsivity = UVA_RESPONSIVITY[(uint8_t)it];
+    dev->b_responsivity = UVB_RESPONSIVITY[(uint8_t)it];
+    dev->integration_time = INTEGRATION_MS[(uint8_t)it];
 }
 
 static VEML6075_error_t check_connected(VEML6075_t *dev) {
@@ -122,9 +230,10 @@ static VEML6075_error_t check_connected(VEML6075_t *dev) {
 }
 
 // Public API implementation
-VEML6075_error_t veml6075_init(VEML6075_t *dev, i2c_inst_t *i2c) {
+VEML6075_error_t veml6075_init(VEML6075_t *dev, const i2c_device_t *i2c) {
+    I2C_SITE(__func__);
     dev->i2c = i2c;
-    dev->device_address = VEML6075_ADDRESS;
+    dev->device_address = i2c->addr;
     dev->last_read_time = 0;
     dev->integration_time = 0;
     dev->last_index = 0.0f;
@@ -133,6 +242,14 @@ VEML6075_error_t veml6075_init(VEML6075_t *dev, i2c_inst_t *i2c) {
     dev->hd_enabled = false;
     dev->last_uva = 0;
     dev->last_uvb = 0;
+    dev->conf = 0;
+    dev->af_enabled = false;
+    dev->measuring = false;
+    dev->ready_at = get_absolute_time();
+    dev->it = IT_100MS;
+    dev->auto_range = false;
+    dev->range = 2;
+    dev->max_range = NUM_RANGES - 1;
     
     VEML6075_error_t err = check_connected(dev);
     if (err != VEML6075_ERROR_SUCCESS) {
@@ -153,6 +270,7 @@ bool veml6075_is_connected(VEML6075_t *dev) {
 }
 
 VEML6075_error_t veml6075_set_integration_time(VEML6075_t *dev, veml6075_uv_it_t it) {
+    I2C_SITE(__func__);
     if (it >= IT_RESERVED_0) {
         return VEML6075_ERROR_UNDEFINED;
     }
@@ -170,18 +288,7 @@ VEML6075_error_t veml6075_set_integration_time(VEML6075_t *dev, veml6075_uv_it_t
         return err;
     }
     
-    dev->a_responsivity = UVA_RESPONSIVITY[(uint8_t)it];
-    dev->b_responsivity = UVB_RESPONSIVITY[(uint8_t)it];
-    
-    switch (it) {
-        case IT_50MS:  dev->integration_time = 50; break;
-        case IT_100MS: dev->integration_time = 100; break;
-        case IT_200MS: dev->integration_time = 200; break;
-        case IT_400MS: dev->integration_time = 400; break;
-        case IT_800MS: dev->integration_time = 800; break;
-        default: dev->integration_time = 0; break;
-    }
-    
+    set_it_fields(dev, it);
     return err;
 }
 
@@ -195,6 +302,7 @@ veml6075_uv_it_t veml6075_get_integration_time(VEML6075_t *dev) {
 }
 
 VEML6075_error_t veml6075_set_high_dynamic(VEML6075_t *dev, veml6075_hd_t hd) {
+    I2C_SITE(__func__);
     uint16_t conf;
     VEML6075_error_t err = read_i2c_register(dev, &conf, REG_UV_CONF);
     if (err != VEML6075_ERROR_SUCCESS) {
@@ -238,6 +346,7 @@ veml6075_uv_trig_t veml6075_get_trigger(VEML6075_t *dev) {
 }
 
 VEML6075_error_t veml6075_set_auto_force(VEML6075_t *dev, veml6075_af_t af) {
+    I2C_SITE(__func__);
     uint16_t conf;
     VEML6075_error_t err = read_i2c_register(dev, &conf, REG_UV_CONF);
     if (err != VEML6075_ERROR_SUCCESS) {
@@ -246,7 +355,12 @@ VEML6075_error_t veml6075_set_auto_force(VEML6075_t *dev, veml6075_af_t af) {
     
     conf &= ~(VEML6075_AF_MASK);
     conf |= (af << VEML6075_AF_SHIFT);
-    return write_i2c_register(dev, conf, REG_UV_CONF);
+    err = write_i2c_register(dev, conf, REG_UV_CONF);
+    if (err == VEML6075_ERROR_SUCCESS) {
+        dev->af_enabled = (af == AF_ENABLE);
+        dev->measuring = false;
+    }
+    return err;
 }
 
 veml6075_af_t veml6075_get_auto_force(VEML6075_t *dev) {
@@ -263,6 +377,7 @@ VEML6075_error_t veml6075_power_on(VEML6075_t *dev, bool enable) {
 }
 
 VEML6075_error_t veml6075_shutdown(VEML6075_t *dev, bool shutdown) {
+    I2C_SITE(__func__);
     uint16_t conf;
     VEML6075_error_t err = read_i2c_register(dev, &conf, REG_UV_CONF);
     if (err != VEML6075_ERROR_SUCCESS) {
@@ -319,42 +434,235 @@ uint16_t veml6075_get_uv_comp2(VEML6075_t *dev) {
     return (uvcomp2[0] & 0x00FF) | ((uvcomp2[1] & 0x00FF) << 8);
 }
 
-float veml6075_get_uva(VEML6075_t *dev) {
-    float raw_uva = (float)veml6075_get_raw_uva(dev);
-    float comp1 = (float)veml6075_get_uv_comp1(dev);
-    float comp2 = (float)veml6075_get_uv_comp2(dev);
-    
-    return raw_uva - ((UVA_A_COEF * UV_ALPHA * comp1) / UV_GAMMA) - 
-           ((UVA_B_COEF * UV_ALPHA * comp2) / UV_DELTA);
+static void fill_snapshot(VEML6075_t *dev, veml6075_snapshot_t *snap,
+                          const uint16_t vals[4], uint64_t time_us) {
+    snap->uva = vals[0];
+    snap->uvb = vals[1];
+    snap->comp1 = vals[2];
+    snap->comp2 = vals[3];
+    snap->time_us = time_us;
+    snap->it = dev->it;
+    snap->hd = dev->hd_enabled;
+    dev->last_read_time = (uint32_t)(time_us / 1000);
+    dev->last_uva = snap->uva;
+    dev->last_uvb = snap->uvb;
 }
 
-float veml6075_get_uvb(VEML6075_t *dev) {
-    float raw_uvb = (float)veml6075_get_raw_uvb(dev);
-    float comp1 = (float)veml6075_get_uv_comp1(dev);
-    float comp2 = (float)veml6075_get_uv_comp2(dev);
-    
-    return raw_uvb - ((UVA_C_COEF * UV_BETA * comp1) / UV_GAMMA) - 
-           ((UVA_D_COEF * UV_BETA * comp2) / UV_DELTA);
+VEML6075_error_t veml6075_read_snapshot(VEML6075_t *dev, veml6075_snapshot_t *snap) {
+    I2C_SITE(__func__);
+    static const uint8_t regs[] = {
+        REG_UVA_DATA, REG_UVB_DATA, REG_UVCOMP1_DATA, REG_UVCOMP2_DATA};
+    uint16_t vals[4];
+    uint64_t time_us;
+    VEML6075_error_t err = read_i2c_registers(dev, vals, regs, 4, &time_us);
+    if (err != VEML6075_ERROR_SUCCESS) {
+        return err;
+    }
+    fill_snapshot(dev, snap, vals, time_us);
+    return VEML6075_ERROR_SUCCESS;
 }
 
-float veml6075_get_index(VEML6075_t *dev) {
-    float uva_calc = veml6075_get_uva(dev);
-    float uvb_calc = veml6075_get_uvb(dev);
+// Only the UV_CONF shadow changes; the next trigger writes it anyway, so a
+// range change costs no extra transaction and no extra sample.
+static void set_range_shadow(VEML6075_t *dev, uint8_t range) {
+    dev->range = range;
+    dev->conf &= ~(VEML6075_UV_IT_MASK | VEML6075_HD_MASK);
+    dev->conf |= (RANGES[range].it << VEML6075_UV_IT_SHIFT) |
+                 (RANGES[range].hd << VEML6075_HD_SHIFT);
+    dev->hd_enabled = (RANGES[range].hd == DYNAMIC_HIGH);
+    set_it_fields(dev, RANGES[range].it);
+}
+
+// Steps one range at a time, judged on the largest of the four channels.
+static void auto_range_update(VEML6075_t *dev, const veml6075_snapshot_t *snap) {
+    uint16_t peak = snap->uva;
+    if (snap->uvb > peak) peak = snap->uvb;
+    if (snap->comp1 > peak) peak = snap->comp1;
+    if (snap->comp2 > peak) peak = snap->comp2;
+
+    if (peak >= VEML6075_RANGE_HIGH_COUNTS && dev->range > 0) {
+        set_range_shadow(dev, dev->range - 1);
+    } else if (peak < VEML6075_RANGE_LOW_COUNTS && dev->range < dev->max_range) {
+        set_range_shadow(dev, dev->range + 1);
+    }
+}
+
+// Active force mode only: lets veml6075_read_measurement choose IT and HD
+// for the following trigger, never integrating longer than max_it. Starts
+// from the ladder step closest to the current setting.
+VEML6075_error_t veml6075_set_auto_range(VEML6075_t *dev, bool enable, veml6075_uv_it_t max_it) {
+    if (max_it >= IT_RESERVED_0) {
+        return VEML6075_ERROR_UNDEFINED;
+    }
+    dev->auto_range = enable;
+    if (!enable) {
+        return VEML6075_ERROR_SUCCESS;
+    }
+    dev->max_range = 0;
+    for (uint8_t r = 0; r < NUM_RANGES; r++) {
+        if (RANGES[r].it <= max_it) {
+            dev->max_range = r;
+        }
+    }
+    uint8_t range = 0;
+    for (uint8_t r = 0; r <= dev->max_range; r++) {
+        if (RANGES[r].it <= dev->it &&
+            RANGES[r].hd == (dev->hd_enabled ? DYNAMIC_HIGH : DYNAMIC_NORMAL)) {
+            range = r;
+        }
+    }
+    set_range_shadow(dev, range);
+    return VEML6075_ERROR_SUCCESS;
+}
+
+// Worst case time from UV_TRIG to results, from the cached integration time
+// (the same value veml6075_get_integration_time would read back).
+uint32_t veml6075_measurement_ms(VEML6075_t *dev) {
+    return dev->integration_time +
+           dev->integration_time / VEML6075_IT_TOLERANCE_DIV +
+           VEML6075_TRIGGER_MARGIN_MS;
+}
+
+// Active force mode only: starts one measurement unless one is already
+// running. The sensor goes back to idle by itself once it is done.
+VEML6075_error_t veml6075_start_measurement(VEML6075_t *dev) {
+    I2C_SITE(__func__);
+    if (!dev->af_enabled) {
+        return VEML6075_ERROR_UNDEFINED;
+    }
+    if (dev->measuring && !time_reached(dev->ready_at)) {
+        return VEML6075_ERROR_SUCCESS;
+    }
+    // the cached UV_CONF saves the read half of veml6075_trigger's
+    // read-modify-write
+    uint8_t d[2] = {(uint8_t)(dev->conf | VEML6075_TRIG_MASK),
+                    (uint8_t)(dev->conf >> 8)};
+    VEML6075_error_t err = write_i2c_buffer(dev, d, REG_UV_CONF, VEML6075_REGISTER_LENGTH);
+    if (err != VEML6075_ERROR_SUCCESS) {
+        return err;
+    }
+    dev->measuring = true;
+    dev->ready_at = make_timeout_time_ms(veml6075_measurement_ms(dev));
+    return VEML6075_ERROR_SUCCESS;
+}
+
+// Reads the result of veml6075_start_measurement. Returns
+// VEML6075_ERROR_NOT_READY, without touching the bus, until dev->ready_at;
+// after that UV_CONF is read in the same queued batch as the data, ahead of
+// it, and a UV_TRIG that is still set also means not ready. So a
+// half-finished integration is never returned.
+VEML6075_error_t veml6075_read_measurement(VEML6075_t *dev, veml6075_snapshot_t *snap) {
+    I2C_SITE(__func__);
+    static const uint8_t regs[] = {
+        REG_UV_CONF, REG_UVA_DATA, REG_UVB_DATA, REG_UVCOMP1_DATA, REG_UVCOMP2_DATA};
+    uint16_t vals[5];
+    if (!dev->measuring) {
+        return VEML6075_ERROR_UNDEFINED;
+    }
+    if (!time_reached(dev->ready_at)) {
+        return VEML6075_ERROR_NOT_READY;
+    }
+    uint64_t time_us;
+    VEML6075_error_t err = read_i2c_registers(dev, vals, regs, 5, &time_us);
+    if (err != VEML6075_ERROR_SUCCESS) {
+        return err;
+    }
+    if (vals[0] & VEML6075_TRIG_MASK) {
+        dev->ready_at = make_timeout_time_ms(VEML6075_TRIGGER_MARGIN_MS);
+        return VEML6075_ERROR_NOT_READY;
+    }
+    dev->measuring = false;
+    fill_snapshot(dev, snap, vals + 1, time_us);
+    if (dev->auto_range) {
+        auto_range_update(dev, snap);
+    }
+    return VEML6075_ERROR_SUCCESS;
+}
+
+float veml6075_snapshot_uva(const veml6075_snapshot_t *snap) {
+    return (float)snap->uva - ((UVA_A_COEF * UV_ALPHA * snap->comp1) / UV_GAMMA) - 
+           ((UVA_B_COEF * UV_ALPHA * snap->comp2) / UV_DELTA);
+}
+
+float veml6075_snapshot_uvb(const veml6075_snapshot_t *snap) {
+    return (float)snap->uvb - ((UVA_C_COEF * UV_BETA * snap->comp1) / UV_GAMMA) - 
+           ((UVA_D_COEF * UV_BETA * snap->comp2) / UV_DELTA);
+}
+
+float veml6075_snapshot_index(VEML6075_t *dev, const veml6075_snapshot_t *snap) {
+    float uva_calc = veml6075_snapshot_uva(snap);
+    float uvb_calc = veml6075_snapshot_uvb(snap);
     
-    // float uvia = uva_calc * (1.0f / UV_ALPHA) * dev->a_responsivity;
-    // float uvib = uvb_calc * (1.0f / UV_BETA) * dev->b_responsivity;
-    float uvia = uva_calc * 0.001111f;
-    float uvib = uvb_calc  * 0.00125f;
+    // responsivity of the range the snapshot was taken with, which is not
+    // necessarily the current one when auto-ranging
+    float uvia = uva_calc * (1.0f / UV_ALPHA) * UVA_RESPONSIVITY[(uint8_t)snap->it];
+    float uvib = uvb_calc * (1.0f / UV_BETA) * UVB_RESPONSIVITY[(uint8_t)snap->it];
     dev->last_index = (uvia + uvib) / 2.0f;
     
-    if (dev->hd_enabled) {
+    if (snap->hd) {
         dev->last_index *= HD_SCALAR;
     }
     
-    dev->last_read_time = to_ms_since_boot(get_absolute_time());
     return dev->last_index;
 }
 
+// Fixed-point versions of the three functions above; the alpha..delta
+// factors are all 1 and left out.
+static int64_t snapshot_uva_q16(const veml6075_snapshot_t *snap) {
+    return ((int64_t)snap->uva << 16) - UVA_A_COEF_Q16 * snap->comp1 -
+           UVA_B_COEF_Q16 * snap->comp2;
+}
+
+static int64_t snapshot_uvb_q16(const veml6075_snapshot_t *snap) {
+    return ((int64_t)snap->uvb << 16) - UVA_C_COEF_Q16 * snap->comp1 -
+           UVA_D_COEF_Q16 * snap->comp2;
+}
+
+// compensated counts, rounded; Q16 would not fit 32 bits
+int32_t veml6075_snapshot_uva_counts(const veml6075_snapshot_t *snap) {
+    return (int32_t)((snapshot_uva_q16(snap) + (1 << 15)) >> 16);
+}
+
+int32_t veml6075_snapshot_uvb_counts(const veml6075_snapshot_t *snap) {
+    return (int32_t)((snapshot_uvb_q16(snap) + (1 << 15)) >> 16);
+}
+
+q16_t veml6075_snapshot_index_q16(const veml6075_snapshot_t *snap) {
+    // Q16 counts * Q32 responsivity = Q48; each product stays below 2^57,
+    // so the sum of both channels fits. One more shift halves it for the
+    // average.
+    int64_t sum = snapshot_uva_q16(snap) * UVA_RESPONSIVITY_Q32[(uint8_t)snap->it] +
+                  snapshot_uvb_q16(snap) * UVB_RESPONSIVITY_Q32[(uint8_t)snap->it];
+    q16_t index = (q16_t)(sum >> 33);
+    return snap->hd ? index * 2 : index;
+}
+
+// The single-value getters below each take their own snapshot; callers that
+// need more than one value should read one snapshot and compute from it.
+float veml6075_get_uva(VEML6075_t *dev) {
+    veml6075_snapshot_t snap;
+    if (veml6075_read_snapshot(dev, &snap) != VEML6075_ERROR_SUCCESS) {
+        return 0.0f;
+    }
+    return veml6075_snapshot_uva(&snap);
+}
+
+float veml6075_get_uvb(VEML6075_t *dev) {
+    veml6075_snapshot_t snap;
+    if (veml6075_read_snapshot(dev, &snap) != VEML6075_ERROR_SUCCESS) {
+        return 0.0f;
+    }
+    return veml6075_snapshot_uvb(&snap);
+}
+
+float veml6075_get_index(VEML6075_t *dev) {
+    veml6075_snapshot_t snap;
+    if (veml6075_read_snapshot(dev, &snap) != VEML6075_ERROR_SUCCESS) {
+        return dev->last_index;
+    }
+    return veml6075_snapshot_index(dev, &snap);
+}
+
 uint16_t veml6075_get_visible_compensation(VEML6075_t *dev) {
     return veml6075_get_uv_comp1(dev);
 }
@@ -364,6 +672,7 @@ uint16_t veml6075_get_ir_compensation(VEML6075_t *dev) {
 }
 
 VEML6075_error_t veml6075_get_device_id(VEML6075_t *dev, uint8_t *id) {
+    I2C_SITE(__func__);
     uint16_t dev_id = 0;
     VEML6075_error_t err = read_i2c_register(dev, &dev_id, REG_ID);
     if (err != VEML6075_ERROR_SUCCESS) {
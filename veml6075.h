@@ -7,13 +7,15 @@
 #define VEML6075_H
 
 #include "pico/stdlib.h"
-#include "hardware/i2c.h"
+#include "i2c_device.h"
+#include "fixed_point.h"
 #include <stdbool.h>
 #include <stdint.h>
 
 // I2C Address
 #define VEML6075_ADDRESS 0x10
 #define VEML6075_DEVICE_ID 0x26
+#define VEML6075_MAX_HZ 400000
 
 // Register addresses
 typedef enum {
@@ -31,7 +33,8 @@ typedef enum {
     VEML6075_ERROR_UNDEFINED = -1,
     VEML6075_ERROR_INVALID_ADDRESS = -2,
     VEML6075_ERROR_READ = -3,
-    VEML6075_ERROR_WRITE = -4
+    VEML6075_ERROR_WRITE = -4,
+    VEML6075_ERROR_NOT_READY = -5
 } VEML6075_error_t;
 
 // Integration time options
@@ -72,9 +75,20 @@ typedef enum {
     SHUT_DOWN = 0x01
 } VEML6075_shutdown_t;
 
+// UVA, UVB, UVCOMP1 and UVCOMP2 read together, see veml6075_read_snapshot
+typedef struct {
+    uint16_t uva;
+    uint16_t uvb;
+    uint16_t comp1; // visible compensation
+    uint16_t comp2; // IR compensation
+    uint64_t time_us; // time_us_64() when the last register read completed
+    veml6075_uv_it_t it; // range the counts were integrated with
+    bool hd;
+} veml6075_snapshot_t;
+
 // VEML6075 device structure
 typedef struct {
-    i2c_inst_t *i2c;
+    const i2c_device_t *i2c;
     uint8_t device_address;
     uint32_t last_read_time;
     uint16_t integration_time;
@@ -84,10 +98,18 @@ typedef struct {
     bool hd_enabled;
     uint16_t last_uva;
     uint16_t last_uvb;
+    uint16_t conf;             // UV_CONF as written, or as the next trigger writes it
+    bool af_enabled;           // active force: one measurement per trigger
+    bool measuring;            // triggered, result not read yet
+    absolute_time_t ready_at;  // when the triggered measurement is done
+    veml6075_uv_it_t it;
+    bool auto_range;           // pick IT and HD from the last counts
+    uint8_t range;             // index into the auto-range ladder
+    uint8_t max_range;
 } VEML6075_t;
 
 // Function prototypes
-VEML6075_error_t veml6075_init(VEML6075_t *dev, i2c_inst_t *i2c);
+VEML6075_error_t veml6075_init(VEML6075_t *dev, const i2c_device_t *i2c);
 bool veml6075_is_connected(VEML6075_t *dev);
 
 VEML6075_error_t veml6075_set_integration_time(VEML6075_t *dev, veml6075_uv_it_t it);
@@ -106,6 +128,20 @@ VEML6075_error_t veml6075_power_on(VEML6075_t *dev, bool enable);
 VEML6075_error_t veml6075_shutdown(VEML6075_t *dev, bool shutdown);
 VEML6075_error_t veml6075_trigger(VEML6075_t *dev);
 
+VEML6075_error_t veml6075_set_auto_range(VEML6075_t *dev, bool enable, veml6075_uv_it_t max_it);
+
+uint32_t veml6075_measurement_ms(VEML6075_t *dev);
+VEML6075_error_t veml6075_start_measurement(VEML6075_t *dev);
+VEML6075_error_t veml6075_read_measurement(VEML6075_t *dev, veml6075_snapshot_t *snap);
+
+VEML6075_error_t veml6075_read_snapshot(VEML6075_t *dev, veml6075_snapshot_t *snap);
+float veml6075_snapshot_uva(const veml6075_snapshot_t *snap);
+float veml6075_snapshot_uvb(const veml6075_snapshot_t *snap);
+float veml6075_snapshot_index(VEML6075_t *dev, const veml6075_snapshot_t *snap);
+int32_t veml6075_snapshot_uva_counts(const veml6075_snapshot_t *snap);
+int32_t veml6075_snapshot_uvb_counts(const veml6075_snapshot_t *snap);
+q16_t veml6075_snapshot_index_q16(const veml6075_snapshot_t *snap);
+
 float veml6075_get_uva(VEML6075_t *dev);
 float veml6075_get_uvb(VEML6075_t *dev);
 float veml6075_get_index(VEML6075_t *dev);